@@ -15,29 +15,111 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "readline_shell.hpp"
+#include "stream_shell.hpp"
+#include "server.hpp"
 
 #include <metashell/parse_config.hpp>
 #include <metashell/config.hpp>
 #include <metashell/default_environment_detector.hpp>
+#include <metashell/cached_environment_detector.hpp>
+#include <metashell/default_pch.hpp>
+#include <metashell/evaluator_pool.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 #ifdef _WIN32
 #  include <windows.h>
 #endif
 
+namespace
+{
+  std::vector<std::string> read_metaprograms(const std::string& path_)
+  {
+    std::ifstream f(path_.c_str());
+    if (!f)
+    {
+      throw std::runtime_error("Failed to open " + path_);
+    }
+
+    std::vector<std::string> result;
+    for (std::string line; std::getline(f, line); )
+    {
+      if (
+        std::find_if(
+          line.begin(),
+          line.end(),
+          [](char c_) { return !std::isspace(c_); }
+        ) != line.end()
+      )
+      {
+        result.push_back(line);
+      }
+    }
+    return result;
+  }
+
+  std::vector<std::string> read_lines(std::istream& in_)
+  {
+    std::vector<std::string> result;
+    for (std::string line; std::getline(in_, line); )
+    {
+      result.push_back(line);
+    }
+    return result;
+  }
+
+  std::vector<std::string> read_batch(const std::string& path_)
+  {
+    if (path_ == "-")
+    {
+      return read_lines(std::cin);
+    }
+    else
+    {
+      std::ifstream f(path_.c_str());
+      if (!f)
+      {
+        throw std::runtime_error("Failed to open " + path_);
+      }
+      return read_lines(f);
+    }
+  }
+}
+
 int main(int argc_, const char* argv_[])
 {
   try
   {
+    const boost::optional<int>
+      worker_exit_code = metashell::evaluator_pool::run_worker(argc_, argv_);
+    if (worker_exit_code)
+    {
+      return *worker_exit_code;
+    }
+
     using metashell::parse_config;
     using metashell::parse_config_result;
 
     const parse_config_result
       r = parse_config(argc_, argv_, &std::cout, &std::cerr);
 
-    metashell::default_environment_detector det(argv_[0]);
+    metashell::default_environment_detector default_det(argv_[0]);
+    // The build does not use or change the detection cache of the user
+    metashell::cached_environment_detector
+      det(
+        default_det,
+        r.should_build_default_pch() ?
+          std::string() :
+          metashell::default_environment_cache_file(),
+        r.cfg.redetect
+      );
     const metashell::config cfg = detect_config(r.cfg, det, std::cerr);
 
     if (r.should_run_shell())
@@ -46,11 +128,39 @@ int main(int argc_, const char* argv_[])
       shell.display_splash();
       shell.run();
     }
+    else if (r.should_evaluate_all())
+    {
+      stream_shell shell(cfg, std::cout, std::cerr);
+      shell.run_metaprograms(read_metaprograms(r.evaluate_all_file));
+      return shell.errors_displayed() ? 1 : 0;
+    }
+    else if (r.should_run_batch())
+    {
+      const int
+        jobs =
+          r.jobs > 0 ?
+            r.jobs :
+            std::max(1, int(std::thread::hardware_concurrency()));
+
+      stream_shell shell(cfg, std::cout, std::cerr);
+      shell.lines_available(read_batch(r.batch_file), jobs);
+      return shell.errors_displayed() ? 1 : 0;
+    }
+    else if (r.should_run_server())
+    {
+      metashell::json_shell shell(cfg);
+      run_server(shell, r.server_socket);
+    }
+    else if (r.should_build_default_pch())
+    {
+      metashell::build_default_pch(r.default_pch_dir, cfg);
+    }
     return r.should_error_at_exit() ? 1 : 0;
   }
   catch (std::exception& e_)
   {
     std::cerr << "Error: " << e_.what() << std::endl;
+    return 1;
   }
 }
 
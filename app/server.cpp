@@ -0,0 +1,103 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "server.hpp"
+
+#include <boost/asio.hpp>
+
+#include <istream>
+#include <stdexcept>
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+  typedef boost::asio::local::stream_protocol protocol;
+
+  // Removes the socket left behind by a previous server. Anything else
+  // found at the path is not ours to delete, therefore it is an error.
+  void remove_socket(const std::string& socket_)
+  {
+    struct stat st;
+    if (lstat(socket_.c_str(), &st) == 0)
+    {
+      if (!S_ISSOCK(st.st_mode))
+      {
+        throw std::runtime_error(socket_ + " exists and it is not a socket.");
+      }
+      unlink(socket_.c_str());
+    }
+  }
+
+  void serve_client(metashell::json_shell& shell_, protocol::socket& socket_)
+  {
+    boost::asio::streambuf buff;
+    while (!shell_.stopped())
+    {
+      boost::system::error_code ec;
+      boost::asio::read_until(socket_, buff, '\n', ec);
+      if (ec)
+      {
+        return;
+      }
+
+      std::istream in(&buff);
+      std::string request;
+      std::getline(in, request);
+
+      if (!request.empty())
+      {
+        const std::string response = shell_.process_request(request) + "\n";
+        boost::asio::write(socket_, boost::asio::buffer(response), ec);
+        if (ec)
+        {
+          return;
+        }
+      }
+    }
+  }
+}
+
+void run_server(metashell::json_shell& shell_, const std::string& socket_)
+{
+  remove_socket(socket_);
+
+  boost::asio::io_service io_service;
+  protocol::acceptor acceptor(io_service, protocol::endpoint(socket_));
+
+  while (!shell_.stopped())
+  {
+    protocol::socket socket(io_service);
+    acceptor.accept(socket);
+    serve_client(shell_, socket);
+  }
+
+  acceptor.close();
+  remove_socket(socket_);
+}
+
+#else
+
+void run_server(metashell::json_shell&, const std::string&)
+{
+  throw std::runtime_error("Server mode is not supported on this platform.");
+}
+
+#endif
+
@@ -0,0 +1,31 @@
+#ifndef METASHELL_SERVER_HPP
+#define METASHELL_SERVER_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/json_shell.hpp>
+
+#include <string>
+
+// Listens on a Unix domain socket and processes the newline-delimited JSON
+// requests of the clients using the same shell, so the environment is parsed
+// only once. The clients are served one after the other. Returns when a
+// shutdown request has been processed.
+void run_server(metashell::json_shell& shell_, const std::string& socket_);
+
+#endif
+
@@ -0,0 +1,65 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "stream_shell.hpp"
+
+#include <iostream>
+
+stream_shell::stream_shell(
+  const metashell::config& config_,
+  std::ostream& out_,
+  std::ostream& err_
+) :
+  shell(config_),
+  _out(out_),
+  _err(err_),
+  _errors_displayed(false)
+{}
+
+void stream_shell::add_history(const std::string&)
+{}
+
+void stream_shell::display_normal(const std::string& s_) const
+{
+  if (!s_.empty())
+  {
+    _out << s_ << std::endl;
+  }
+}
+
+void stream_shell::display_info(const std::string& s_) const
+{
+  _out << s_;
+}
+
+void stream_shell::display_error(const std::string& s_) const
+{
+  if (!s_.empty())
+  {
+    _err << s_ << std::endl;
+    _errors_displayed = true;
+  }
+}
+
+unsigned int stream_shell::width() const
+{
+  return 80;
+}
+
+bool stream_shell::errors_displayed() const
+{
+  return _errors_displayed;
+}
@@ -0,0 +1,52 @@
+#ifndef STREAM_SHELL_HPP
+#define STREAM_SHELL_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/shell.hpp>
+#include <metashell/config.hpp>
+
+#include <iosfwd>
+#include <string>
+
+// A non-interactive shell displaying everything without highlighting
+class stream_shell : public metashell::shell
+{
+public:
+  stream_shell(
+    const metashell::config& config_,
+    std::ostream& out_,
+    std::ostream& err_
+  );
+
+  virtual void add_history(const std::string& s_);
+
+  virtual void display_normal(const std::string& s_) const;
+  virtual void display_info(const std::string& s_) const;
+  virtual void display_error(const std::string& s_) const;
+
+  virtual unsigned int width() const;
+
+  bool errors_displayed() const;
+private:
+  std::ostream& _out;
+  std::ostream& _err;
+  mutable bool _errors_displayed;
+};
+
+#endif
+
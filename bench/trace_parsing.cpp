@@ -0,0 +1,222 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares how fast the templight trace formats mdb supports are loaded.
+// The traces are generated, they look like the trace of a recursive
+// metaprogram where most of the instantiations are memoizations.
+
+#include <metashell/metaprogram.hpp>
+
+#include <boost/lexical_cast.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace metashell;
+
+namespace
+{
+  struct trace_event
+  {
+    bool begin;
+    int kind;
+    std::string name;
+    int line;
+    double timestamp;
+  };
+
+  std::vector<trace_event> generate_events(int instantiations_)
+  {
+    std::vector<trace_event> result;
+    double time = 0;
+    for (int i = 0; i != instantiations_; ++i)
+    {
+      const std::string name =
+        "fib<std::integral_constant<int, " + std::to_string(i) + ">>";
+      result.push_back({true, 0, name, i, time += 0.001});
+      if (i > 1)
+      {
+        const std::string memoized =
+          "fib<std::integral_constant<int, " + std::to_string(i - 2) + ">>";
+        result.push_back({true, 8, memoized, i, time += 0.001});
+        result.push_back({false, 8, "", 0, time += 0.001});
+      }
+    }
+    for (int i = 0; i != instantiations_; ++i)
+    {
+      result.push_back({false, 0, "", 0, time += 0.001});
+    }
+    return result;
+  }
+
+  const char* kind_name(int kind_)
+  {
+    return kind_ == 0 ? "TemplateInstantiation" : "Memoization";
+  }
+
+  std::string escape_xml(const std::string& s_)
+  {
+    std::string result;
+    for (char c : s_)
+    {
+      switch (c)
+      {
+      case '<': result += "&lt;"; break;
+      case '>': result += "&gt;"; break;
+      case '&': result += "&amp;"; break;
+      default: result += c;
+      }
+    }
+    return result;
+  }
+
+  // The same output the XmlPrinter of templight generates
+  std::string to_xml(const std::vector<trace_event>& events_)
+  {
+    std::ostringstream s;
+    s << "<?xml version=\"1.0\" standalone=\"yes\"?>\n<Trace>\n";
+    for (const trace_event& e : events_)
+    {
+      if (e.begin)
+      {
+        s
+          << "<TemplateBegin>\n"
+          << "    <Kind>" << kind_name(e.kind) << "</Kind>\n"
+          << "    <Context context = \"" << escape_xml(e.name) << "\"/>\n"
+          << "    <PointOfInstantiation>/tmp/fib.hpp|" << e.line
+            << "|7</PointOfInstantiation>\n"
+          << "    <TimeStamp time = \"" << e.timestamp << "\"/>\n"
+          << "    <MemoryUsage bytes = \"0\"/>\n"
+          << "</TemplateBegin>\n";
+      }
+      else
+      {
+        s
+          << "<TemplateEnd>\n"
+          << "    <Kind>" << kind_name(e.kind) << "</Kind>\n"
+          << "    <TimeStamp time = \"" << e.timestamp << "\"/>\n"
+          << "    <MemoryUsage bytes = \"0\"/>\n"
+          << "</TemplateEnd>\n";
+      }
+    }
+    s << "</Trace>\n";
+    return s.str();
+  }
+
+  void append_integer(std::string& out_, std::uint64_t value_, int bytes_)
+  {
+    for (int i = 0; i != bytes_; ++i)
+    {
+      out_ += char((value_ >> (8 * i)) & 0xFF);
+    }
+  }
+
+  // The same output the BinaryPrinter of templight generates
+  std::string to_binary(const std::vector<trace_event>& events_)
+  {
+    std::string result("TLBT");
+    append_integer(result, 1, 4);
+
+    std::map<std::string, std::size_t> strings;
+    const auto append_string =
+      [&strings](std::string& out_, const std::string& s_)
+      {
+        const auto i = strings.find(s_);
+        if (i == strings.end())
+        {
+          append_integer(out_, strings.size(), 4);
+          append_integer(out_, s_.size(), 4);
+          out_ += s_;
+          strings.insert(std::make_pair(s_, strings.size()));
+        }
+        else
+        {
+          append_integer(out_, i->second, 4);
+        }
+      };
+
+    for (const trace_event& e : events_)
+    {
+      std::uint64_t timestamp;
+      std::memcpy(&timestamp, &e.timestamp, sizeof(timestamp));
+
+      std::string payload;
+      append_integer(payload, e.begin ? 1 : 0, 1);
+      append_integer(payload, e.kind, 1);
+      append_integer(payload, timestamp, 8);
+      append_integer(payload, 0, 8);
+      if (e.begin)
+      {
+        append_string(payload, e.name);
+        append_string(payload, "/tmp/fib.hpp");
+        append_integer(payload, e.line, 4);
+        append_integer(payload, 7, 4);
+      }
+      append_integer(result, payload.size(), 4);
+      result += payload;
+    }
+    return result;
+  }
+
+  template <class F>
+  void measure(
+    const std::string& format_,
+    const std::string& trace_,
+    std::size_t events_,
+    F load_
+  )
+  {
+    const auto start = std::chrono::steady_clock::now();
+    const metaprogram mp = load_(trace_, "<root>", "int");
+    const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    std::cout
+      << format_ << ": " << trace_.size() / 1024 << " KB, "
+      << elapsed.count() << " s, "
+      << trace_.size() / elapsed.count() / (1024 * 1024) << " MB/s, "
+      << events_ / elapsed.count() << " events/s, "
+      << mp.get_num_edges() << " edges" << std::endl;
+  }
+}
+
+int main(int argc_, char* argv_[])
+{
+  const int instantiations =
+    argc_ > 1 ? boost::lexical_cast<int>(argv_[1]) : 100000;
+
+  const std::vector<trace_event> events = generate_events(instantiations);
+
+  measure(
+    "xml",
+    to_xml(events),
+    events.size(),
+    metaprogram::create_from_xml_string
+  );
+  measure(
+    "binary",
+    to_binary(events),
+    events.size(),
+    metaprogram::create_from_binary_string
+  );
+}
+
@@ -0,0 +1,78 @@
+#ifndef METASHELL_CACHED_ENVIRONMENT_DETECTOR_HPP
+#define METASHELL_CACHED_ENVIRONMENT_DETECTOR_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/iface/environment_detector.hpp>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace metashell
+{
+  // Remembers the results of the detection steps running clang in a file,
+  // so the shells started later can skip them. The results are bound to
+  // the path, size and modification time of the clang binary and the
+  // version of Metashell. The rest of the steps are forwarded to the
+  // wrapped detector.
+  class cached_environment_detector : public iface::environment_detector
+  {
+  public:
+    // An empty cache_file_ disables caching. When redetect_ is true, the
+    // results in the cache are ignored and replaced.
+    cached_environment_detector(
+      iface::environment_detector& detector_,
+      const std::string& cache_file_,
+      bool redetect_
+    );
+
+    virtual std::string search_clang_binary();
+    virtual bool file_exists(const std::string& path_);
+
+    virtual bool on_windows();
+
+    virtual void append_to_path(const std::string& path_);
+
+    virtual std::vector<std::string> default_clang_sysinclude(
+      const std::string& clang_path_
+    );
+    virtual std::vector<std::string> extra_sysinclude();
+
+    virtual std::string path_of_executable();
+
+    virtual bool clang_binary_works_with_libclang(const config& cfg_);
+  private:
+    iface::environment_detector& _detector;
+    std::string _cache_file;
+    std::map<std::string, std::vector<std::string>> _cache;
+
+    std::vector<std::string> cached(
+      const std::string& key_,
+      const std::function<std::vector<std::string>()>& detect_
+    );
+    void save() const;
+  };
+
+  // The file in the home directory of the user. Empty when the home
+  // directory is unknown.
+  std::string default_environment_cache_file();
+}
+
+#endif
+
@@ -0,0 +1,41 @@
+#ifndef METASHELL_DEFAULT_PCH_HPP
+#define METASHELL_DEFAULT_PCH_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/config.hpp>
+
+#include <string>
+
+namespace metashell
+{
+  // The default environment is precompiled for every standard during the
+  // build and shipped next to the binary. The precompiled headers can be
+  // used only with the libclang and Metashell versions they were built
+  // with, which are recorded with them.
+
+  // Precompiles the default environment into dir_
+  void build_default_pch(const std::string& dir_, const config& config_);
+
+  // The precompiled default environment for the standard of config_. It is
+  // empty when it is missing or was built with a different version of
+  // libclang or Metashell.
+  std::string default_pch(const config& config_);
+}
+
+#endif
+
@@ -0,0 +1,43 @@
+#ifndef METASHELL_DIGEST_HPP
+#define METASHELL_DIGEST_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <boost/uuid/sha1.hpp>
+
+#include <string>
+
+namespace metashell
+{
+  // SHA-1 digest of a string built by appending to it. The digest of the
+  // content appended so far can be queried at any time, therefore appending
+  // is not proportional to the size of the whole string.
+  class digest
+  {
+  public:
+    void append(char c_);
+    void append(const std::string& s_);
+
+    // In hexadecimal format
+    std::string value() const;
+  private:
+    boost::uuids::detail::sha1 _sha1;
+  };
+}
+
+#endif
+
@@ -18,7 +18,9 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <boost/utility.hpp>
+#include <boost/utility/string_ref.hpp>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -38,6 +40,14 @@ namespace metashell
     virtual std::string get() const = 0;
     virtual std::string get_appended(const std::string& s_) const = 0;
 
+    // The concatenation of the parts is get(). The parts are not copied,
+    // they are valid until the environment is changed or destroyed.
+    virtual std::vector<boost::string_ref> get_parts() const = 0;
+
+    // The SHA-1 digest of get(). It is used to tell if an evaluator process
+    // has the code of the environment already.
+    virtual std::string get_digest() const = 0;
+
     virtual std::string internal_dir() const = 0;
 
     virtual std::vector<std::string>& clang_arguments() = 0;
@@ -47,6 +57,22 @@ namespace metashell
 
     // Returns parts that are in precompiled header files as well
     virtual std::string get_all() const = 0;
+
+    // The SHA-1 digest of get_all(). It is updated incrementally by append,
+    // so it is cheap to call. Caches use it to identify the content, so it
+    // has to be a strong digest, not only a hash.
+    virtual std::string get_all_digest() const = 0;
+
+    // Creates an environment with the same content, which can be extended
+    // without changing this one. It may use the files (eg. precompiled
+    // headers) of this environment, therefore this one has to outlive it.
+    virtual std::unique_ptr<environment> create_child() const = 0;
+
+    // Makes the environment use the results of the work finished in the
+    // background (eg. precompiled headers) since the last change. The const
+    // members do not pick them up, so they return the same until the next
+    // call to append or refresh.
+    virtual void refresh() = 0;
   };
 }
 
@@ -0,0 +1,79 @@
+#ifndef METASHELL_ENVIRONMENT_SNAPSHOT_HPP
+#define METASHELL_ENVIRONMENT_SNAPSHOT_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/environment.hpp>
+#include <metashell/headers.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace metashell
+{
+  // A read-only copy of an environment. It is used to rebuild the
+  // environment of the shell in an evaluator process. The code is shared by
+  // the copies of the snapshot, get_all() is the same as get(), since the
+  // parts of the environment in precompiled headers are reached through the
+  // clang arguments.
+  class environment_snapshot : public environment
+  {
+  public:
+    explicit environment_snapshot(const environment& env_);
+
+    // Builds the snapshot from its parts (eg. after sending them to another
+    // process). code_ is the result of get() of the environment and
+    // digest_ is its digest.
+    environment_snapshot(
+      std::shared_ptr<const std::string> code_,
+      const std::string& digest_,
+      const std::vector<std::string>& clang_args_,
+      const headers& headers_,
+      const std::string& all_digest_
+    );
+
+    virtual void append(const std::string& s_);
+    virtual std::string get() const;
+    virtual std::string get_appended(const std::string& s_) const;
+    virtual std::vector<boost::string_ref> get_parts() const;
+    virtual std::string get_digest() const;
+
+    virtual std::string internal_dir() const;
+
+    virtual std::vector<std::string>& clang_arguments();
+    virtual const std::vector<std::string>& clang_arguments() const;
+
+    virtual const headers& get_headers() const;
+
+    virtual std::string get_all() const;
+    virtual std::string get_all_digest() const;
+
+    virtual std::unique_ptr<environment> create_child() const;
+
+    virtual void refresh();
+  private:
+    std::shared_ptr<const std::string> _code;
+    std::string _digest;
+    std::vector<std::string> _clang_args;
+    headers _headers;
+    std::string _all_digest;
+  };
+}
+
+#endif
+
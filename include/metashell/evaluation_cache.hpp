@@ -0,0 +1,91 @@
+#ifndef METASHELL_EVALUATION_CACHE_HPP
+#define METASHELL_EVALUATION_CACHE_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/result.hpp>
+
+#include <boost/optional.hpp>
+
+#include <list>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace metashell
+{
+  class config;
+  class environment;
+
+  // Stores the results of the last evaluated metaprograms. An entry is
+  // identified by the content of the environment, the clang arguments, the
+  // verbosity and the evaluated expression. The least recently used entry is
+  // dropped when the cache is full.
+  class evaluation_cache
+  {
+  public:
+    explicit evaluation_cache(int max_size_);
+
+    boost::optional<result> find(
+      const environment& env_,
+      const config& config_,
+      const std::string& expression_
+    );
+
+    void add(
+      const environment& env_,
+      const config& config_,
+      const std::string& expression_,
+      const result& result_
+    );
+
+    void clear();
+
+    int max_size() const;
+    int size() const;
+
+    int hits() const;
+    int misses() const;
+  private:
+    // digest of the environment, the clang arguments, verbosity and the
+    // expression. The clang arguments are stored and compared, not only
+    // their hash, so different arguments never share an entry.
+    typedef
+      std::tuple<std::string, std::vector<std::string>, bool, std::string>
+      key;
+
+    // The most recently used entry is at the front
+    typedef std::list<std::pair<key, result>> entry_list;
+
+    int _max_size;
+    int _hits;
+    int _misses;
+
+    entry_list _entries;
+    std::map<key, entry_list::iterator> _index;
+
+    static key make_key(
+      const environment& env_,
+      const config& config_,
+      const std::string& expression_
+    );
+  };
+}
+
+#endif
+
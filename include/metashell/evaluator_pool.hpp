@@ -0,0 +1,133 @@
+#ifndef METASHELL_EVALUATOR_POOL_HPP
+#define METASHELL_EVALUATOR_POOL_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/config.hpp>
+#include <metashell/environment.hpp>
+#include <metashell/result.hpp>
+
+#include <boost/optional.hpp>
+#include <boost/utility.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace metashell
+{
+  // Evaluates code in worker processes started in advance. The workers run
+  // the executable of the shell again (see run_worker), so they do not
+  // inherit the state (eg. the threads) of the shell. An evaluation
+  // crashing or exceeding the memory or time limit kills only its worker,
+  // which is replaced by a new one. The result of such an evaluation has
+  // resource_limit_exceeded set. Workers are also replaced after evaluating
+  // config::evaluator_queries_per_process queries.
+  class evaluator_pool : boost::noncopyable
+  {
+  public:
+    // The number of workers and their limits are taken from config_
+    explicit evaluator_pool(const config& config_);
+    ~evaluator_pool();
+
+    // Has to be called at the beginning of main. When the process was
+    // started as a worker, it serves the shell and returns the exit code of
+    // the process. Otherwise it remembers the executable to start the
+    // workers with and returns nothing.
+    static boost::optional<int> run_worker(
+      int argc_,
+      const char* const argv_[]
+    );
+
+    // Keeps at least processes_ workers running (eg. one for each thread
+    // evaluating in parallel). The missing ones are started now.
+    void reserve(int processes_);
+
+    // An evaluation is aborted by killing its worker when *cancelled_
+    // becomes true. The flag is polled, so a signal handler can set it. A
+    // cancelled evaluation returns nothing.
+    boost::optional<result> eval_tmp_formatted(
+      const environment& env_,
+      const std::string& tmp_exp_,
+      const config& config_,
+      const std::string& input_filename_,
+      const std::atomic<bool>* cancelled_ = nullptr
+    );
+
+    // Evaluates the metaprograms in one translation unit
+    boost::optional<std::vector<result>> eval_tmp_formatted(
+      const environment& env_,
+      const std::vector<std::string>& tmp_exps_,
+      const config& config_,
+      const std::string& input_filename_,
+      const std::atomic<bool>* cancelled_ = nullptr
+    );
+
+    // Skips the function bodies when declarations_only_ is true
+    boost::optional<result> validate_code(
+      const std::string& s_,
+      const config& config_,
+      const environment& env_,
+      const std::string& input_filename_,
+      bool declarations_only_ = false,
+      const std::atomic<bool>* cancelled_ = nullptr
+    );
+
+    // A failed completion has no candidates
+    void code_complete(
+      const environment& env_,
+      const std::string& src_,
+      const std::string& input_filename_,
+      std::set<std::string>& out_
+    );
+  private:
+    class worker;
+
+    std::string _binary;
+    std::mutex _lock;
+    std::vector<std::unique_ptr<worker>> _idle;
+    int _processes;
+    int _memory_limit_mb;
+    int _timeout_sec;
+    int _queries_per_process;
+
+    std::unique_ptr<worker> new_worker() const;
+    // Sends request_ to a worker. The code of env_ is sent as well when the
+    // worker does not have it. Returns false when it was cancelled. When
+    // the worker fails (eg. crashes) response_ is empty and failure_
+    // describes what happened.
+    bool run(
+      const std::vector<std::string>& request_,
+      const environment& env_,
+      std::vector<std::string>& response_,
+      std::string& failure_,
+      const std::atomic<bool>* cancelled_
+    );
+    boost::optional<result> run_for_result(
+      const std::vector<std::string>& request_,
+      const environment& env_,
+      const std::atomic<bool>* cancelled_
+    );
+    void give_back(std::unique_ptr<worker> worker_);
+  };
+}
+
+#endif
+
@@ -17,11 +17,18 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <metashell/config.hpp>
 #include <metashell/in_memory_environment.hpp>
 #include <metashell/headers.hpp>
+#include <metashell/pch_cache.hpp>
 
 #include <just/temp.hpp>
 
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
 namespace metashell
 {
   class header_file_environment : public environment
@@ -32,6 +39,8 @@ namespace metashell
     virtual void append(const std::string& s_);
     virtual std::string get() const;
     virtual std::string get_appended(const std::string& s_) const;
+    virtual std::vector<boost::string_ref> get_parts() const;
+    virtual std::string get_digest() const;
 
     virtual std::string internal_dir() const;
 
@@ -41,16 +50,72 @@ namespace metashell
     virtual const headers& get_headers() const;
 
     virtual std::string get_all() const;
+    virtual std::string get_all_digest() const;
+
+    virtual std::unique_ptr<environment> create_child() const;
+
+    virtual void refresh();
+
+    // Waits for the code appended so far to get precompiled. The code
+    // failed to precompile remains in get().
+    void finish_precompiling();
   private:
+    config _config;
     just::temp::directory _dir;
+    // Null when the precompiled headers are not cached
+    std::unique_ptr<pch_cache> _pch_cache;
+    std::string _internal_dir;
     in_memory_environment _buffer;
     std::vector<std::string> _clang_args;
     headers _empty_headers;
 
     bool _use_precompiled_headers;
-    std::string _clang_path;
+    // Builds the precompiled headers using the clang binary or libclang
+    pch_cache::precompiler _precompile;
+    // Identifies the compiler _precompile uses in the cache
+    std::string _compiler;
+
+    // The environment is precompiled in a chain of headers. The first one
+    // contains the entire environment at the time it was built, the rest of
+    // them contain the code appended after that. Each precompiled header is
+    // built on top of the previous one, therefore appending compiles only
+    // the appended code.
+    std::vector<std::string> _pch_chain;
+    int _next_layer;
+    // The position of the path of the last precompiled header of the chain
+    // in _clang_args. It is 0 while the chain is empty.
+    std::vector<std::string>::size_type _pch_arg_index;
+
+    // The code appended after the last precompiled header that is ready. It
+    // is passed to clang as plain text until it gets precompiled.
+    std::string _tail;
+
+    // The header being precompiled in the background. The destructor of
+    // the future waits for it to finish, therefore it has to be destroyed
+    // before _dir and _pch_cache.
+    // The future returns the header that got precompiled.
+    std::future<std::string> _precompiling;
+    // The length of the prefix of _tail the header being precompiled covers
+    std::string::size_type _precompiling_length;
+    // When it is true, the header being precompiled contains the entire
+    // environment and replaces the chain.
+    bool _precompiling_everything;
+
+    // Shares the precompiled headers of parent_
+    explicit header_file_environment(const header_file_environment& parent_);
 
     void save();
+    // Makes args_ (a copy of _clang_args) use pch_ as the last precompiled
+    // header of the chain. Returns the position of pch_ in args_.
+    std::vector<std::string>::size_type use_pch(
+      std::vector<std::string>& args_,
+      const std::string& pch_
+    ) const;
+    // Uses the default environment precompiled during the build as the
+    // first precompiled header when it is compatible with the settings
+    bool use_default_pch();
+    void start_precompiling();
+    void use_finished_precompiled_header();
     std::string env_filename() const;
   };
 }
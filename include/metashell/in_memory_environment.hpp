@@ -19,8 +19,11 @@
 
 #include <metashell/environment.hpp>
 #include <metashell/headers.hpp>
+#include <metashell/digest.hpp>
 
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace metashell
 {
@@ -35,9 +38,14 @@ namespace metashell
       const std::string& clang_extra_arg_ = ""
     );
 
+    // Shares the code of e_ instead of copying it
+    in_memory_environment(const in_memory_environment& e_);
+
     virtual void append(const std::string& s_);
     virtual std::string get() const;
     virtual std::string get_appended(const std::string& s_) const;
+    virtual std::vector<boost::string_ref> get_parts() const;
+    virtual std::string get_digest() const;
 
     virtual std::string internal_dir() const;
 
@@ -49,8 +57,24 @@ namespace metashell
     void add_clang_arg(const std::string& arg_);
 
     virtual std::string get_all() const;
+    virtual std::string get_all_digest() const;
+
+    virtual std::unique_ptr<environment> create_child() const;
+
+    virtual void refresh();
   private:
-    std::string _buffer;
+    // The code is the concatenation of the parts inherited from the parent
+    // environments and _code. The inherited parts are shared with the
+    // parents and never change, therefore creating a child does not copy
+    // the code.
+    std::vector<std::shared_ptr<const std::string>> _inherited;
+    // The code appended to this environment (starting with the separator
+    // when it is not the first part). It grows by appending to it, so
+    // appending is not proportional to the size of the environment. It is
+    // copied before appending when a child shares it.
+    std::shared_ptr<std::string> _code;
+    std::string::size_type _size;
+    digest _digest;
     headers _headers;
     std::vector<std::string> _clang_args;
   };
@@ -0,0 +1,64 @@
+#ifndef METASHELL_JSON_SHELL_HPP
+#define METASHELL_JSON_SHELL_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/shell.hpp>
+#include <metashell/config.hpp>
+
+#include <string>
+#include <vector>
+
+namespace metashell
+{
+  // A shell processing requests of the server mode. Each request is a JSON
+  // object in one line, for example:
+  //
+  //   {"id": "1", "type": "evaluate", "code": "int"}
+  //
+  // The supported types are evaluate, validate, complete, environment_add,
+  // environment_push, environment_pop and shutdown. The response is a JSON
+  // object in one line containing the id of the request, the output, info
+  // and error messages displayed while processing it and the type specific
+  // results ("valid" for validate and "completions" for complete).
+  class json_shell : public shell
+  {
+  public:
+    explicit json_shell(const config& config_);
+
+    // Takes ownership of env_
+    json_shell(const config& config_, environment* env_);
+
+    virtual void add_history(const std::string& s_);
+
+    virtual void display_normal(const std::string& s_) const;
+    virtual void display_info(const std::string& s_) const;
+    virtual void display_error(const std::string& s_) const;
+
+    virtual unsigned int width() const;
+
+    // Returns the response without the closing new line
+    std::string process_request(const std::string& request_);
+  private:
+    mutable std::vector<std::string> _output;
+    mutable std::vector<std::string> _info;
+    mutable std::vector<std::string> _errors;
+  };
+}
+
+#endif
+
@@ -24,6 +24,7 @@
 
 #include <metashell/config.hpp>
 #include <metashell/metaprogram.hpp>
+#include <metashell/metaprogram_profile.hpp>
 #include <metashell/colored_string.hpp>
 #include <metashell/templight_environment.hpp>
 #include <metashell/mdb_command_handler_map.hpp>
@@ -64,6 +65,8 @@ public:
   void command_evaluate(const std::string& arg);
   void command_forwardtrace(const std::string& arg);
   void command_backtrace(const std::string& arg);
+  void command_profile(const std::string& arg);
+  void command_export(const std::string& arg);
   void command_rbreak(const std::string& arg);
   void command_help(const std::string& arg);
   void command_quit(const std::string& arg);
@@ -91,6 +94,9 @@ protected:
   void display_current_full_forwardtrace(
       boost::optional<unsigned> max_depth) const;
   void display_backtrace() const;
+  void display_profile(
+      const std::vector<profile_entry>& profile,
+      unsigned max_count) const;
   void display_argument_parsing_failed() const;
   void display_metaprogram_reached_the_beginning() const;
   void display_metaprogram_finished() const;
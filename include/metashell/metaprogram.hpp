@@ -21,12 +21,15 @@
 #include <tuple>
 #include <string>
 #include <vector>
+#include <cstdint>
 
 #include <boost/optional.hpp>
-#include <boost/graph/graph_traits.hpp>
-#include <boost/graph/adjacency_list.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <boost/iterator/counting_iterator.hpp>
 
+#include <metashell/string_pool.hpp>
 #include <metashell/file_location.hpp>
+#include <metashell/templight_format.hpp>
 #include <metashell/instantiation_kind.hpp>
 
 namespace metashell {
@@ -54,40 +57,67 @@ public:
       const std::string& root_name,
       const std::string& evaluation_result);
 
-  struct vertex_property_tag {
-    typedef boost::vertex_property_tag kind;
-  };
-  struct edge_property_tag {
-    typedef boost::edge_property_tag kind;
-  };
+  static metaprogram create_from_binary_stream(
+      std::istream& stream,
+      const std::string& root_name,
+      const std::string& evaluation_result);
+
+  static metaprogram create_from_binary_file(
+      const std::string& file,
+      const std::string& root_name,
+      const std::string& evaluation_result);
+
+  static metaprogram create_from_binary_string(
+      const std::string& string,
+      const std::string& root_name,
+      const std::string& evaluation_result);
+
+  static metaprogram create_from_file(
+      const std::string& file,
+      templight_format::type format,
+      const std::string& root_name,
+      const std::string& evaluation_result);
+
+  // The vertices and the edges are identified by their index in the order
+  // they were added.
+  typedef std::uint32_t vertex_descriptor;
+  typedef std::uint32_t edge_descriptor;
+
+  typedef boost::counting_iterator<vertex_descriptor> vertex_iterator;
+  typedef boost::counting_iterator<edge_descriptor> edge_iterator;
+  typedef std::vector<edge_descriptor>::const_iterator in_edge_iterator;
+  typedef std::vector<edge_descriptor>::const_iterator out_edge_iterator;
+
+  typedef std::uint32_t vertices_size_type;
+  typedef std::uint32_t edges_size_type;
 
   struct vertex_property {
     std::string name;
   };
+
+  // A file_location with the file name stored in the pool of the
+  // metaprogram
+  struct pooled_file_location {
+    string_pool::id_type file;
+    int row;
+    int column;
+  };
+
   struct edge_property {
     instantiation_kind kind;
-    file_location point_of_instantiation;
     bool enabled = true;
+    pooled_file_location point_of_instantiation;
+
+    // Collected by templight. The times are in seconds, the memory usages
+    // are the change of the heap size while the instantiation was running.
+    // The self_ values don't include the nested instantiations.
+    double begin_timestamp = 0.0;
+    double time_taken = 0.0;
+    double self_time = 0.0;
+    long long memory_usage = 0;
+    long long self_memory_usage = 0;
   };
 
-  typedef boost::adjacency_list<
-    boost::vecS,
-    boost::vecS,
-    boost::bidirectionalS,
-    boost::property<vertex_property_tag, vertex_property>,
-    boost::property<edge_property_tag, edge_property>> graph_t;
-
-  typedef boost::graph_traits<graph_t>::vertex_descriptor vertex_descriptor;
-  typedef boost::graph_traits<graph_t>::edge_descriptor edge_descriptor;
-
-  typedef boost::graph_traits<graph_t>::vertex_iterator vertex_iterator;
-  typedef boost::graph_traits<graph_t>::edge_iterator edge_iterator;
-  typedef boost::graph_traits<graph_t>::in_edge_iterator in_edge_iterator;
-  typedef boost::graph_traits<graph_t>::out_edge_iterator out_edge_iterator;
-
-  typedef boost::graph_traits<graph_t>::vertices_size_type vertices_size_type;
-  typedef boost::graph_traits<graph_t>::edges_size_type edges_size_type;
-
   typedef boost::optional<vertex_descriptor> optional_vertex_descriptor;
   typedef boost::optional<edge_descriptor> optional_edge_descriptor;
 
@@ -139,7 +169,6 @@ public:
   backtrace_t get_backtrace() const;
   unsigned get_backtrace_length() const;
 
-  const graph_t& get_graph() const;
   const state_t& get_state() const;
 
   vertices_size_type get_num_vertices() const;
@@ -148,6 +177,11 @@ public:
   vertex_descriptor get_source(const edge_descriptor& edge) const;
   vertex_descriptor get_target(const edge_descriptor& edge) const;
 
+  // The first edge from -> to
+  optional_edge_descriptor find_edge(
+      vertex_descriptor from,
+      vertex_descriptor to) const;
+
   boost::iterator_range<in_edge_iterator> get_in_edges(
       vertex_descriptor vertex) const;
   boost::iterator_range<out_edge_iterator> get_out_edges(
@@ -166,8 +200,32 @@ public:
   edge_property& get_edge_property(
       edge_descriptor edge);
 
+  file_location get_point_of_instantiation(edge_descriptor edge) const;
+  const string_pool& get_file_names() const;
+
 private:
-  graph_t graph;
+  // The in and out edges of the vertices in compressed sparse row format:
+  // the edges of vertex v are edges[offsets[v]] .. edges[offsets[v + 1]] in
+  // the order they were added.
+  struct adjacency_t {
+    std::vector<edges_size_type> offsets;
+    std::vector<edge_descriptor> edges;
+  };
+
+  void update_adjacency() const;
+
+  std::vector<vertex_property> vertices;
+
+  std::vector<vertex_descriptor> edge_sources;
+  std::vector<vertex_descriptor> edge_targets;
+  std::vector<edge_property> edge_properties;
+
+  string_pool file_names;
+
+  // Built on the first query after adding vertices or edges
+  mutable adjacency_t out_adjacency;
+  mutable adjacency_t in_adjacency;
+  mutable bool adjacency_up_to_date = false;
 
   state_t state;
   state_history_t state_history;
@@ -0,0 +1,41 @@
+#ifndef METASHELL_METAPROGRAM_EXPORT_HPP
+#define METASHELL_METAPROGRAM_EXPORT_HPP
+
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ostream>
+
+#include <metashell/metaprogram.hpp>
+
+namespace metashell {
+
+// The enabled edges are exported. As in forwardtrace, the instantiations
+// of a type are expanded only at its first occurrence.
+
+// One line per stack of instantiations with the time spent in the last one
+// in microseconds, the format of flamegraph.pl and speedscope.
+void write_folded_stacks(const metaprogram& mp, std::ostream& out);
+
+// Begin and end events of the Chrome trace event format, for
+// chrome://tracing and Perfetto.
+void write_chrome_trace(const metaprogram& mp, std::ostream& out);
+
+}
+
+#endif
+
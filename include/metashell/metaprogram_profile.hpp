@@ -0,0 +1,65 @@
+#ifndef METASHELL_METAPROGRAM_PROFILE_HPP
+#define METASHELL_METAPROGRAM_PROFILE_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <string>
+#include <vector>
+
+#include <metashell/metaprogram.hpp>
+
+namespace metashell {
+
+// The cost of instantiating a type or the instances of a template
+struct profile_entry {
+  std::string name;
+  unsigned count = 0;
+  double self_time = 0.0;
+  double total_time = 0.0;
+  long long self_memory_usage = 0;
+  long long memory_usage = 0;
+};
+
+enum class profile_order {
+  self_time,
+  total_time,
+  count,
+  memory
+};
+
+// The name of the template a type is an instance of: the template
+// arguments are removed. Eg. "std::vector<int>::iterator" becomes
+// "std::vector::iterator".
+std::string template_name(const std::string& type);
+
+// Only the enabled non-memoization edges are counted. The entries are
+// sorted in descending order.
+std::vector<profile_entry> profile_instantiations(
+    const metaprogram& mp,
+    profile_order order);
+
+// The total cost of a template contains the cost of the instances
+// instantiated while an other instance of it is being instantiated (eg.
+// the steps of a recursion) only once.
+std::vector<profile_entry> profile_templates(
+    const metaprogram& mp,
+    profile_order order);
+
+}
+
+#endif
+
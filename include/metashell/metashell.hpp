@@ -29,6 +29,11 @@
 
 namespace metashell
 {
+  class cxindex;
+
+  // The overloads taking a cxindex reuse the translation unit of the previous
+  // call on the same index. The other ones parse everything from scratch.
+
   result eval_tmp_unformatted(
     const environment& env_,
     const std::string& tmp_exp_,
@@ -36,6 +41,14 @@ namespace metashell
     const std::string& input_filename_
   );
 
+  result eval_tmp_unformatted(
+    cxindex& index_,
+    const environment& env_,
+    const std::string& tmp_exp_,
+    const config& config_,
+    const std::string& input_filename_
+  );
+
   result eval_tmp_formatted(
     const environment& env_,
     const std::string& tmp_exp_,
@@ -43,7 +56,40 @@ namespace metashell
     const std::string& input_filename_
   );
 
+  result eval_tmp_formatted(
+    cxindex& index_,
+    const environment& env_,
+    const std::string& tmp_exp_,
+    const config& config_,
+    const std::string& input_filename_
+  );
+
+  // Evaluates multiple metaprograms in one translation unit. The nth element
+  // of the result belongs to the nth metaprogram.
+  std::vector<result> eval_tmp_formatted(
+    const environment& env_,
+    const std::vector<std::string>& tmp_exps_,
+    const config& config_,
+    const std::string& input_filename_
+  );
+
+  std::vector<result> eval_tmp_formatted(
+    cxindex& index_,
+    const environment& env_,
+    const std::vector<std::string>& tmp_exps_,
+    const config& config_,
+    const std::string& input_filename_
+  );
+
+  result validate_code(
+    const std::string& s_,
+    const config& config_,
+    const environment& env_,
+    const std::string& intput_filename_
+  );
+
   result validate_code(
+    cxindex& index_,
     const std::string& s_,
     const config& config_,
     const environment& env_,
@@ -57,6 +103,14 @@ namespace metashell
     std::set<std::string>& out_
   );
 
+  void code_complete(
+    cxindex& index_,
+    const environment& env_,
+    const std::string& src_,
+    const std::string& input_filename_,
+    std::set<std::string>& out_
+  );
+
   bool is_environment_setup_command(
     command::iterator begin_,
     const command::iterator& end_
@@ -66,6 +120,9 @@ namespace metashell
   {
     return is_environment_setup_command(cmd_.begin(), cmd_.end());
   }
+
+  // The code every shell starts with
+  std::string default_environment();
 }
 
 #endif
@@ -20,6 +20,7 @@
 #include <metashell/user_config.hpp>
 
 #include <iosfwd>
+#include <string>
 
 namespace metashell
 {
@@ -28,18 +29,53 @@ namespace metashell
     enum action_t
     {
       run_shell,
+      evaluate_all,
+      run_batch,
+      run_server,
+      build_default_pch,
       exit_with_error,
       exit_without_error
     };
 
     action_t action;
     user_config cfg;
+    // The file listing the metaprograms to evaluate in evaluate_all mode
+    std::string evaluate_all_file;
+    // The file to process in batch mode ("-" means the standard input)
+    std::string batch_file;
+    // The number of worker threads to use in batch mode
+    int jobs;
+    // The Unix domain socket to listen on in server mode
+    std::string server_socket;
+    // The directory to precompile the default environment into
+    std::string default_pch_dir;
 
     bool should_run_shell() const;
+    bool should_evaluate_all() const;
+    bool should_run_batch() const;
+    bool should_run_server() const;
+    bool should_build_default_pch() const;
     bool should_error_at_exit() const;
 
     static parse_config_result exit(bool with_error_);
     static parse_config_result start_shell(const user_config& cfg_);
+    static parse_config_result start_evaluate_all(
+      const user_config& cfg_,
+      const std::string& file_
+    );
+    static parse_config_result start_batch(
+      const user_config& cfg_,
+      const std::string& file_,
+      int jobs_
+    );
+    static parse_config_result start_server(
+      const user_config& cfg_,
+      const std::string& socket_
+    );
+    static parse_config_result start_build_default_pch(
+      const user_config& cfg_,
+      const std::string& dir_
+    );
   };
 
   parse_config_result parse_config(
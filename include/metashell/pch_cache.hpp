@@ -0,0 +1,97 @@
+#ifndef METASHELL_PCH_CACHE_HPP
+#define METASHELL_PCH_CACHE_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace metashell
+{
+  // Precompiled headers stored in a directory, so other shells (running
+  // at the same time or later) can reuse them. They are looked up based on
+  // the content of the header, the clang arguments and the clang binary.
+  // The files included by the header are recorded when it is precompiled
+  // and a precompiled header is rebuilt when any of them changes. The least
+  // recently used precompiled headers are removed when the size of the
+  // cache exceeds the limit. The precompiled headers a pch_cache object
+  // has returned are pinned until it is destroyed: they are listed in a
+  // file of the pins directory, which is ignored once its process is not
+  // running, and they are never removed while pinned.
+  class pch_cache
+  {
+  public:
+    typedef
+      std::function<
+        void(
+          const std::vector<std::string>& clang_args_,
+          const std::string& header_,
+          const std::string& pch_
+        )
+      >
+      precompiler;
+
+    // max_size_mb_ is the size limit in MB. 0 means no limit.
+    pch_cache(const std::string& directory_, int max_size_mb_);
+
+    // Pins the precompiled headers other_ has returned as well
+    pch_cache(const pch_cache& other_);
+    pch_cache& operator=(const pch_cache&) = delete;
+
+    ~pch_cache();
+
+    // The internal directory for the headers Metashell generates. The
+    // precompiled headers including them can be reused only when they are
+    // at the same location in every shell.
+    std::string headers_directory() const;
+
+    // Returns the header containing content_. Its precompiled version is
+    // the header's path followed by ".pch". It is built by calling
+    // precompile_ unless the cache already has an up to date one. compiler_
+    // identifies what precompile_ uses: the path of the clang binary (its
+    // size and modification time are checked as well) or the version of
+    // libclang.
+    std::string precompiled_header(
+      const std::string& compiler_,
+      const std::vector<std::string>& clang_args_,
+      const std::string& content_,
+      const precompiler& precompile_
+    );
+  private:
+    std::string _directory;
+    unsigned long long _max_size;
+    // The file listing _pinned. It is created by the first pin.
+    std::string _pin_file;
+    std::set<std::string> _pinned;
+    // precompiled_header may run in the background while the object is
+    // copied
+    mutable std::mutex _pin_lock;
+
+    void pin(const std::string& key_);
+    void save_pins();
+    std::set<std::string> pinned_by_running_processes() const;
+    bool up_to_date(const std::string& key_) const;
+    void remove_least_recently_used() const;
+    std::string path_of(const std::string& filename_) const;
+  };
+}
+
+#endif
+
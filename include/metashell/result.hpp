@@ -27,6 +27,9 @@ namespace metashell
     std::string output;
     std::vector<std::string> errors;
     std::string info;
+    // Set when the evaluation was aborted because it exceeded the memory or
+    // time limit of the evaluator process
+    bool resource_limit_exceeded;
 
     result();
 
@@ -39,7 +42,8 @@ namespace metashell
     ) :
       output(output_),
       errors(begin_errors_, end_errors_),
-      info(info_)
+      info(info_),
+      resource_limit_exceeded(false)
     {}
 
     bool has_errors() const;
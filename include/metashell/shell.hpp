@@ -19,20 +19,29 @@
 
 #include <metashell/config.hpp>
 #include <metashell/environment.hpp>
+#include <metashell/evaluation_cache.hpp>
+#include <metashell/result.hpp>
+#include <metashell/timing.hpp>
 #include <metashell/pragma_handler_map.hpp>
 
 #include <just/console.hpp>
 
 #include <boost/optional.hpp>
-#include <boost/scoped_ptr.hpp>
 
+#include <atomic>
+#include <functional>
 #include <string>
 #include <set>
 #include <map>
+#include <memory>
 #include <stack>
+#include <vector>
 
 namespace metashell
 {
+  class cxindex;
+  class evaluator_pool;
+
   class shell
   {
   public:
@@ -53,13 +62,36 @@ namespace metashell
 
     void display_splash() const;
     void line_available(const std::string& s_);
+
+    // Processes the lines the same way as line_available does, but the
+    // consecutive queries are evaluated in parallel using worker_count_
+    // threads. The results are displayed in the order of the lines.
+    void lines_available(
+      const std::vector<std::string>& lines_,
+      int worker_count_
+    );
+
     std::string prompt() const;
 
     void cancel_operation();
 
     bool store_in_buffer(const std::string& s_);
+    // Checks if s_ could be added to the environment without changing it
+    result validate(const std::string& s_) const;
+
+    // Checks the entire environment including the function bodies and
+    // displays the errors
+    void check_environment();
     void run_metaprogram(const std::string& s_);
 
+    // Evaluates the metaprograms in one translation unit and displays their
+    // results in order
+    void run_metaprograms(const std::vector<std::string>& s_);
+    void run_metaprograms(
+      const std::vector<std::string>& s_,
+      int worker_count_
+    );
+
     static const char* input_filename();
 
     void code_complete(
@@ -86,18 +118,71 @@ namespace metashell
     void display_environment_stack_size();
     void rebuild_environment();
 
+    const evaluation_cache& get_evaluation_cache() const;
+    void clear_evaluation_cache();
+
+    void timing_enabled(bool enabled_);
+    bool timing_enabled() const;
+
+    // The sum of the timings of the queries evaluated so far
+    const timing& timing_totals() const;
+
     const config& get_config() const;
   private:
     std::string _line_prefix;
-    boost::scoped_ptr<environment> _env;
+    std::unique_ptr<environment> _env;
+    // Keeps the translation unit of the last query alive between queries
+    mutable std::unique_ptr<cxindex> _index;
+    // Used for validating the extensions of the environment when only the
+    // declarations are checked
+    std::unique_ptr<cxindex> _declaration_index;
     config _config;
     std::string _prev_line;
     pragma_handler_map _pragma_handlers;
     bool _stopped;
-    std::stack<std::string> _environment_stack;
+    // The environments are kept alive on the stack, the environment above
+    // them may share their precompiled headers.
+    std::stack<std::unique_ptr<environment>> _environment_stack;
+    evaluation_cache _evaluation_cache;
+
+    // The queries are collected here instead of evaluating them immediately
+    // while processing lines with lines_available
+    bool _deferring_queries;
+    std::vector<std::string> _deferred_queries;
+    int _worker_count;
+    // Each worker of the parallel evaluation has its own index
+    std::vector<std::unique_ptr<cxindex>> _worker_indices;
+    // Evaluates the queries in separate processes when it is not null
+    std::shared_ptr<evaluator_pool> _evaluator_pool;
+    bool _timing_enabled;
+    timing _timing_totals;
+    // Set by cancel_operation, which may be called from a signal handler
+    std::atomic<bool> _cancelled;
 
     void init();
+    void run_deferred_queries();
+
+    // Runs in_pool_ when there is an evaluator pool and in_shell_
+    // otherwise. The evaluator process is killed when the operation is
+    // cancelled, then it returns nothing. An evaluation running in the
+    // shell can not be interrupted.
+    boost::optional<result> run_cancellable(
+      const std::function<
+        boost::optional<result> (evaluator_pool&, const std::atomic<bool>*)
+      >& in_pool_,
+      const std::function<result ()>& in_shell_
+    );
+    // failed_[i] is set when the ith result was built from an exception
+    // instead of evaluating the query
+    std::vector<result> eval_in_parallel(
+      const std::vector<std::string>& s_,
+      int worker_count_,
+      std::vector<bool>& failed_
+    );
     void rebuild_environment(const std::string& content_);
+    std::unique_ptr<environment> create_environment(
+      const std::string& content_
+    ) const;
   };
 }
 
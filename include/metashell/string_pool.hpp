@@ -0,0 +1,103 @@
+#ifndef METASHELL_STRING_POOL_HPP
+#define METASHELL_STRING_POOL_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+
+namespace metashell {
+
+// Open addressing hash table of 32 bit ids. The keys are not stored in the
+// table, find resolves the ids to keys with key_of, so the table can index
+// strings living in any container and can be searched with a string_ref
+// without constructing a std::string.
+class string_index {
+public:
+  typedef std::uint32_t id_type;
+
+  // Marks the empty slots, it can not be used as an id
+  static const id_type empty_slot = ~id_type(0);
+
+  string_index();
+
+  template <class KeyOf>
+  boost::optional<id_type> find(boost::string_ref key, KeyOf key_of) const;
+
+  // key must not be in the index yet
+  void insert(boost::string_ref key, id_type id);
+
+  std::size_t size() const;
+
+private:
+  struct slot {
+    std::uint32_t hash;
+    id_type id;
+  };
+
+  static std::uint32_t hash(boost::string_ref key);
+
+  void grow();
+  void insert_slot(const slot& s);
+
+  std::vector<slot> slots;
+  std::size_t count;
+};
+
+// Stores every distinct string once and refers to them by 32 bit ids.
+class string_pool {
+public:
+  typedef string_index::id_type id_type;
+
+  id_type intern(boost::string_ref s);
+  boost::optional<id_type> find(boost::string_ref s) const;
+
+  const std::string& operator[](id_type id) const;
+  std::size_t size() const;
+
+private:
+  std::vector<std::string> strings;
+  string_index index;
+};
+
+template <class KeyOf>
+boost::optional<string_index::id_type> string_index::find(
+    boost::string_ref key,
+    KeyOf key_of) const
+{
+  if (slots.empty()) {
+    return boost::none;
+  }
+
+  const std::uint32_t h = hash(key);
+  const std::size_t mask = slots.size() - 1;
+  for (std::size_t i = h & mask; slots[i].id != empty_slot; i = (i + 1) & mask)
+  {
+    if (slots[i].hash == h && key == boost::string_ref(key_of(slots[i].id))) {
+      return slots[i].id;
+    }
+  }
+  return boost::none;
+}
+
+}
+
+#endif
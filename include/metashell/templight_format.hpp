@@ -0,0 +1,41 @@
+#ifndef METASHELL_TEMPLIGHT_FORMAT_HPP
+#define METASHELL_TEMPLIGHT_FORMAT_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <string>
+
+namespace metashell
+{
+  // The format of the trace templight writes for mdb
+  namespace templight_format
+  {
+    enum type
+    {
+      xml,
+      binary
+    };
+  }
+
+  templight_format::type parse_templight_format(const std::string& format_);
+
+  // The value of clang's -templight-format argument
+  std::string templight_argument(templight_format::type format_);
+}
+
+#endif
+
@@ -0,0 +1,92 @@
+#ifndef METASHELL_TIMING_HPP
+#define METASHELL_TIMING_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <boost/utility.hpp>
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace metashell
+{
+  // The time spent in the stages of evaluating queries and the memory used
+  // by libclang for them
+  class timing
+  {
+  public:
+    // The name of the stage and the time spent in it in milliseconds
+    typedef std::vector<std::pair<std::string, double> > stages;
+    // The name of the resource and the number of bytes used
+    typedef std::vector<std::pair<std::string, unsigned long> > resources;
+
+    timing();
+
+    // Adding an already known stage increases the time spent in it
+    void add_stage(const std::string& name_, double ms_);
+
+    // Keeps the largest amount used of each resource
+    void add_resource_usage(const std::string& name_, unsigned long bytes_);
+
+    // Adds the stages, resources and queries of t_
+    void add(const timing& t_);
+
+    void count_query();
+
+    const stages& get_stages() const;
+    const resources& get_resources() const;
+    int queries() const;
+
+    // The stages and the resources as C++ comments
+    std::string str() const;
+  private:
+    stages _stages;
+    resources _resources;
+    int _queries;
+  };
+
+  // Records the time spent in its scope as a stage in the timing installed
+  // for the current thread by timing_recorder. Does nothing when there is no
+  // such timing.
+  class timed_stage : boost::noncopyable
+  {
+  public:
+    explicit timed_stage(const char* name_);
+    ~timed_stage();
+  private:
+    const char* _name;
+    std::chrono::steady_clock::time_point _start;
+  };
+
+  // Installs a timing for the current thread in its scope
+  class timing_recorder : boost::noncopyable
+  {
+  public:
+    explicit timing_recorder(timing& timing_);
+    ~timing_recorder();
+
+    // The timing installed for the current thread or null
+    static timing* current();
+  private:
+    timing* _prev;
+  };
+}
+
+#endif
+
@@ -18,6 +18,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <metashell/standard.hpp>
+#include <metashell/templight_format.hpp>
 
 #include <string>
 #include <vector>
@@ -39,6 +40,28 @@ namespace metashell
     std::string clang_path;
     int max_template_depth;
     bool saving_enabled;
+    int evaluation_cache_size;
+    // Evaluating in separate processes (0 means evaluating in the shell)
+    int evaluator_processes;
+    // Limits of the evaluator processes (0 means no limit)
+    int evaluator_memory_limit_mb;
+    int evaluator_timeout_sec;
+    int evaluator_queries_per_process;
+    // Skip the function bodies when validating environment extensions
+    bool validate_declarations_only;
+    // Directory of the precompiled headers shared between shells (empty
+    // means not sharing them) and its size limit (0 means no limit)
+    std::string pch_cache_dir;
+    int pch_cache_size_mb;
+    // Build the precompiled headers using libclang instead of running the
+    // clang binary
+    bool precompile_in_process;
+    // Ignore the environment detection results of the previous shells
+    bool redetect;
+    // The format of the templight traces mdb reads
+    templight_format::type templight_trace_format;
+    // Record the memory usage of the template instantiations in mdb
+    bool templight_memory;
 
     user_config();
   };
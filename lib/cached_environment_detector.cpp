@@ -0,0 +1,239 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/cached_environment_detector.hpp>
+#include <metashell/config.hpp>
+#include <metashell/standard.hpp>
+#include <metashell/version.hpp>
+
+#include <just/environment.hpp>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+using namespace metashell;
+
+namespace
+{
+  // Changes when the binary is replaced or Metashell is upgraded
+  std::string binary_id(const std::string& path_)
+  {
+    boost::system::error_code ec;
+    const boost::uintmax_t size = boost::filesystem::file_size(path_, ec);
+    const std::time_t mtime = boost::filesystem::last_write_time(path_, ec);
+
+    std::ostringstream s;
+    s << version() << " " << path_;
+    if (!ec)
+    {
+      s << " " << size << " " << mtime;
+    }
+    return s.str();
+  }
+
+  // Format: every entry is a key line, the number of values and the
+  // values in separate lines
+  std::map<std::string, std::vector<std::string>> load(
+    const std::string& fn_
+  )
+  {
+    std::map<std::string, std::vector<std::string>> result;
+    std::ifstream f(fn_.c_str());
+    std::string key;
+    std::string count;
+    while (std::getline(f, key) && std::getline(f, count))
+    {
+      std::vector<std::string>& values = result[key];
+      for (int i = std::stoi(count); i > 0; --i)
+      {
+        std::string v;
+        if (std::getline(f, v))
+        {
+          values.push_back(v);
+        }
+        else
+        {
+          // Truncated file
+          result.erase(key);
+          return result;
+        }
+      }
+    }
+    return result;
+  }
+}
+
+cached_environment_detector::cached_environment_detector(
+  iface::environment_detector& detector_,
+  const std::string& cache_file_,
+  bool redetect_
+) :
+  _detector(detector_),
+  _cache_file(cache_file_),
+  _cache()
+{
+  if (!_cache_file.empty() && !redetect_)
+  {
+    try
+    {
+      _cache = load(_cache_file);
+    }
+    catch (const std::exception&)
+    {
+      // Damaged cache file, everything is detected again
+      _cache.clear();
+    }
+  }
+}
+
+std::string cached_environment_detector::search_clang_binary()
+{
+  return _detector.search_clang_binary();
+}
+
+bool cached_environment_detector::file_exists(const std::string& path_)
+{
+  return _detector.file_exists(path_);
+}
+
+bool cached_environment_detector::on_windows()
+{
+  return _detector.on_windows();
+}
+
+void cached_environment_detector::append_to_path(const std::string& path_)
+{
+  _detector.append_to_path(path_);
+}
+
+std::vector<std::string> cached_environment_detector::default_clang_sysinclude(
+  const std::string& clang_path_
+)
+{
+  return
+    cached(
+      "sysinclude " + binary_id(clang_path_),
+      [this, &clang_path_]()
+      {
+        return this->_detector.default_clang_sysinclude(clang_path_);
+      }
+    );
+}
+
+std::vector<std::string> cached_environment_detector::extra_sysinclude()
+{
+  return _detector.extra_sysinclude();
+}
+
+std::string cached_environment_detector::path_of_executable()
+{
+  return _detector.path_of_executable();
+}
+
+bool cached_environment_detector::clang_binary_works_with_libclang(
+  const config& cfg_
+)
+{
+  std::ostringstream key;
+  key
+    << "libclang " << binary_id(cfg_.clang_path)
+    << " " << clang_argument(cfg_.standard_to_use);
+  for (const std::string& arg : cfg_.extra_clang_args)
+  {
+    key << " " << arg;
+  }
+
+  return
+    cached(
+      key.str(),
+      [this, &cfg_]()
+      {
+        return
+          std::vector<std::string>(
+            1,
+            this->_detector.clang_binary_works_with_libclang(cfg_) ?
+              "1" :
+              "0"
+          );
+      }
+    )
+    == std::vector<std::string>(1, "1");
+}
+
+std::vector<std::string> cached_environment_detector::cached(
+  const std::string& key_,
+  const std::function<std::vector<std::string>()>& detect_
+)
+{
+  const auto i = _cache.find(key_);
+  if (i == _cache.end())
+  {
+    const std::vector<std::string> result = detect_();
+    if (!_cache_file.empty())
+    {
+      _cache[key_] = result;
+      save();
+    }
+    return result;
+  }
+  else
+  {
+    return i->second;
+  }
+}
+
+void cached_environment_detector::save() const
+{
+  // Other shells may be reading it, so it is replaced in one step
+  const std::string tmp = _cache_file + ".tmp";
+  {
+    std::ofstream f(tmp.c_str());
+    for (const auto& entry : _cache)
+    {
+      f << entry.first << "\n" << entry.second.size() << "\n";
+      for (const std::string& v : entry.second)
+      {
+        f << v << "\n";
+      }
+    }
+    if (!f)
+    {
+      // The cache is an optimisation, the shell works without it
+      std::remove(tmp.c_str());
+      return;
+    }
+  }
+  boost::system::error_code ec;
+  boost::filesystem::rename(tmp, _cache_file, ec);
+}
+
+std::string metashell::default_environment_cache_file()
+{
+  const std::string home =
+    just::environment::get(
+#ifdef _WIN32
+      "USERPROFILE"
+#else
+      "HOME"
+#endif
+    );
+  return home.empty() ? std::string() : home + "/.metashell_environment";
+}
+
@@ -112,7 +112,12 @@ namespace
   {
     if (user_wants_precompiled_headers_)
     {
-      if (!cfg_.clang_path.empty())
+      if (cfg_.precompile_in_process)
+      {
+        // libclang builds them, the clang binary is not used
+        return true;
+      }
+      else if (!cfg_.clang_path.empty())
       {
         return env_detector_.clang_binary_works_with_libclang(cfg_);
       }
@@ -204,7 +209,19 @@ config::config() :
   standard_to_use(standard::cpp11),
   warnings_enabled(true),
   use_precompiled_headers(false),
-  clang_path()
+  clang_path(),
+  evaluation_cache_size(0),
+  evaluator_processes(0),
+  evaluator_memory_limit_mb(0),
+  evaluator_timeout_sec(0),
+  evaluator_queries_per_process(0),
+  validate_declarations_only(false),
+  pch_cache_dir(),
+  pch_cache_size_mb(1024),
+  precompile_in_process(false),
+  default_pch_dir(),
+  templight_trace_format(templight_format::xml),
+  templight_memory(false)
 {}
 
 config metashell::detect_config(
@@ -232,6 +249,20 @@ config metashell::detect_config(
 
   cfg.max_template_depth = ucfg_.max_template_depth;
   cfg.saving_enabled = ucfg_.saving_enabled;
+  cfg.evaluation_cache_size = ucfg_.evaluation_cache_size;
+  cfg.evaluator_processes = ucfg_.evaluator_processes;
+  cfg.evaluator_memory_limit_mb = ucfg_.evaluator_memory_limit_mb;
+  cfg.evaluator_timeout_sec = ucfg_.evaluator_timeout_sec;
+  cfg.evaluator_queries_per_process = ucfg_.evaluator_queries_per_process;
+  cfg.validate_declarations_only = ucfg_.validate_declarations_only;
+  cfg.pch_cache_dir = ucfg_.pch_cache_dir;
+  cfg.pch_cache_size_mb = ucfg_.pch_cache_size_mb;
+  cfg.precompile_in_process = ucfg_.precompile_in_process;
+  cfg.templight_trace_format = ucfg_.templight_trace_format;
+  cfg.templight_memory = ucfg_.templight_memory;
+  cfg.default_pch_dir =
+    directory_of_file(env_detector_.path_of_executable())
+    + (env_detector_.on_windows() ? "\\" : "/") + "metashell_default_pch";
 
   if (env_detector_.on_windows())
   {
@@ -20,13 +20,24 @@
 
 using namespace metashell;
 
-cxindex::cxindex() : _index(clang_createIndex(0, 0)) {}
+cxindex::cxindex(unsigned int tu_options_) :
+  _index(clang_createIndex(0, 0)),
+  _tu_options(tu_options_),
+  _has_completions(false)
+{}
 
 cxindex::~cxindex()
 {
+  // The translation unit has to be disposed before the index
+  _tu.reset();
   clang_disposeIndex(_index);
 }
 
+unsigned int cxindex::tu_options() const
+{
+  return _tu_options;
+}
+
 std::unique_ptr<cxtranslationunit> cxindex::parse_code(
   const unsaved_file& src_,
   const environment& env_
@@ -34,8 +45,100 @@ std::unique_ptr<cxtranslationunit> cxindex::parse_code(
 {
   return
     std::unique_ptr<cxtranslationunit>(
-      new cxtranslationunit(env_, src_, _index)
+      new cxtranslationunit(env_, src_, _index, _tu_options)
     );
 }
 
+cxtranslationunit& cxindex::reparse_code(
+  const unsaved_file& src_,
+  const environment& env_
+)
+{
+  if (can_reuse_tu(src_, env_))
+  {
+    try
+    {
+      _tu->reparse(env_, src_);
+      return *_tu;
+    }
+    catch (...)
+    {
+      // libclang can not use the translation unit after a failed reparse
+      _tu.reset();
+      throw;
+    }
+  }
+  else
+  {
+    return create_tu(src_, env_);
+  }
+}
+
+const std::set<std::string>& cxindex::code_complete(
+  const unsaved_file& src_,
+  const environment& env_
+)
+{
+  const std::string env = env_.get_all_digest();
+  const std::vector<std::string> args = env_.clang_arguments();
+
+  if (
+    !_has_completions
+    || _completion_filename != src_.filename()
+    || _completion_src != src_.content()
+    || _completion_env != env
+    || _completion_clang_args != args
+  )
+  {
+    _has_completions = false;
+    _completions.clear();
+
+    if (can_reuse_tu(src_, env_))
+    {
+      // Code completion parses the unsaved files itself
+      _tu->update(env_, src_);
+      _tu->code_complete(_completions);
+    }
+    else
+    {
+      create_tu(src_, env_).code_complete(_completions);
+    }
+
+    _completion_filename = src_.filename();
+    _completion_src = src_.content();
+    _completion_env = env;
+    _completion_clang_args = args;
+    _has_completions = true;
+  }
+  return _completions;
+}
+
+bool cxindex::can_reuse_tu(
+  const unsaved_file& src_,
+  const environment& env_
+) const
+{
+  return
+    _tu
+    && _tu_filename == src_.filename()
+    && _tu_clang_args == env_.clang_arguments();
+}
 
+cxtranslationunit& cxindex::create_tu(
+  const unsaved_file& src_,
+  const environment& env_
+)
+{
+  _tu.reset();
+  _tu.reset(
+    new cxtranslationunit(
+      env_,
+      src_,
+      _index,
+      clang_defaultEditingTranslationUnitOptions() | _tu_options
+    )
+  );
+  _tu_filename = src_.filename();
+  _tu_clang_args = env_.clang_arguments();
+  return *_tu;
+}
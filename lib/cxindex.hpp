@@ -27,21 +27,68 @@
 #include <boost/utility.hpp>
 
 #include <memory>
+#include <set>
+#include <string>
+#include <vector>
 
 namespace metashell
 {
   class cxindex : boost::noncopyable
   {
   public:
-    cxindex();
+    // The translation units created by reparse_code and code_complete are
+    // parsed with tu_options_ in addition to the default editing options.
+    // parse_code uses only tu_options_.
+    explicit cxindex(unsigned int tu_options_ = CXTranslationUnit_None);
     ~cxindex();
 
+    unsigned int tu_options() const;
+
     std::unique_ptr<cxtranslationunit> parse_code(
       const unsaved_file& src_,
       const environment& env_
     );
+
+    // Parses the code using a translation unit owned by the index. When the
+    // file name and the clang arguments are the same as in the previous call,
+    // the translation unit of the previous call is reparsed. This can reuse
+    // the precompiled preamble built by the previous parses.
+    cxtranslationunit& reparse_code(
+      const unsaved_file& src_,
+      const environment& env_
+    );
+
+    // The candidates of the last completion context are remembered, so
+    // completing the same code in the same environment again (eg. while the
+    // user is narrowing the candidates) does not run clang again.
+    const std::set<std::string>& code_complete(
+      const unsaved_file& src_,
+      const environment& env_
+    );
   private:
     CXIndex _index;
+    unsigned int _tu_options;
+
+    std::unique_ptr<cxtranslationunit> _tu;
+    std::string _tu_filename;
+    std::vector<std::string> _tu_clang_args;
+
+    bool _has_completions;
+    std::string _completion_filename;
+    std::string _completion_src;
+    std::string _completion_env;
+    std::vector<std::string> _completion_clang_args;
+    std::set<std::string> _completions;
+
+    bool can_reuse_tu(
+      const unsaved_file& src_,
+      const environment& env_
+    ) const;
+
+    cxtranslationunit& create_tu(
+      const unsaved_file& src_,
+      const environment& env_
+    );
   };
 }
 
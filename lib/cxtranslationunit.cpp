@@ -18,16 +18,19 @@
 #include <metashell/text_position.hpp>
 #include <metashell/headers.hpp>
 #include <metashell/exception.hpp>
+#include <metashell/path_builder.hpp>
 
 #include "cxtranslationunit.hpp"
 #include "cxdiagnostic.hpp"
 #include "cxcodecompleteresults.hpp"
+#include "cxstring.hpp"
 
 #include <clang-c/Index.h>
 
 #include <boost/iterator/transform_iterator.hpp>
 
 #include <functional>
+#include <sstream>
 
 using namespace metashell;
 
@@ -46,6 +49,15 @@ namespace
     return CXChildVisit_Recurse;
   }
 
+  const char env_header[] = "__metashell_environment.hpp";
+
+  std::string env_part_header(int n_)
+  {
+    std::ostringstream s;
+    s << "__metashell_environment_" << n_ << ".hpp";
+    return s.str();
+  }
+
   std::string get_nth_error_msg(CXTranslationUnit tu_, int n_)
   {
     return cxdiagnostic(clang_getDiagnostic(tu_, n_)).spelling();
@@ -55,14 +67,33 @@ namespace
   {
     return s_.c_str();
   }
+
+  void inclusion_visitor(
+    CXFile included_file_,
+    CXSourceLocation*,
+    unsigned int include_len_,
+    CXClientData client_data_
+  )
+  {
+    // The main file is visited with an empty include stack
+    if (include_len_ > 0)
+    {
+      static_cast<std::vector<std::string>*>(client_data_)->push_back(
+        std::string(cxstring(clang_getFileName(included_file_)))
+      );
+    }
+  }
 }
 
 cxtranslationunit::cxtranslationunit(
   const environment& env_,
   const unsaved_file& src_,
-  CXIndex index_
+  CXIndex index_,
+  unsigned options_
 ) :
-  _src(src_),
+  _src(),
+  _env_header(),
+  _env_part_filenames(),
   _unsaved_files()
 {
   using boost::transform_iterator;
@@ -77,17 +108,16 @@ cxtranslationunit::cxtranslationunit(
     >
     c_str_it;
 
-  _unsaved_files.reserve(env_.get_headers().size() + 1);
-  for (const unsaved_file& uf : env_.get_headers())
-  {
-    _unsaved_files.push_back(uf.get());
-  }
-  _unsaved_files.push_back(_src.get());
+  update(env_, src_);
 
-  const vector<const char*> argv(
+  vector<const char*> argv(
     c_str_it(env_.clang_arguments().begin(), c_str),
     c_str_it(env_.clang_arguments().end())
   );
+  // The evaluation emits #error directives to tell the diagnostics of the
+  // different parts of the code apart. They must not be lost because of
+  // reaching the error limit.
+  argv.push_back("-ferror-limit=0");
 
   _tu =
     clang_parseTranslationUnit(
@@ -97,7 +127,7 @@ cxtranslationunit::cxtranslationunit(
       argv.size(),
       &_unsaved_files[0],
       _unsaved_files.size(),
-      CXTranslationUnit_None
+      options_
     );
   if (!_tu)
   {
@@ -114,6 +144,78 @@ cxtranslationunit::~cxtranslationunit()
   clang_disposeTranslationUnit(_tu);
 }
 
+std::string cxtranslationunit::environment_include()
+{
+  return "#include <" + std::string(env_header) + ">\n";
+}
+
+void cxtranslationunit::update(
+  const environment& env_,
+  const unsaved_file& src_
+)
+{
+  _src = src_;
+
+  // The parts of the environment are passed to clang without copying
+  // them. The parts inherited from the parent environments never change,
+  // therefore they are found in the precompiled preamble after extending
+  // the environment.
+  const std::vector<boost::string_ref> parts = env_.get_parts();
+  const path_builder internal_dir(env_.internal_dir());
+
+  std::ostringstream includes;
+  for (int i = _env_part_filenames.size(), n = parts.size(); i < n; ++i)
+  {
+    _env_part_filenames.push_back(internal_dir / env_part_header(i));
+  }
+  for (std::vector<boost::string_ref>::size_type i = 0; i != parts.size(); ++i)
+  {
+    includes << "#include <" << env_part_header(i) << ">\n";
+  }
+  _env_header = unsaved_file(internal_dir / env_header, includes.str());
+
+  _unsaved_files.clear();
+  _unsaved_files.reserve(env_.get_headers().size() + parts.size() + 2);
+  for (const unsaved_file& uf : env_.get_headers())
+  {
+    _unsaved_files.push_back(uf.get());
+  }
+  _unsaved_files.push_back(_env_header.get());
+  for (std::vector<boost::string_ref>::size_type i = 0; i != parts.size(); ++i)
+  {
+    CXUnsavedFile part;
+    part.Filename = _env_part_filenames[i].c_str();
+    part.Contents = parts[i].data();
+    part.Length = parts[i].size();
+    _unsaved_files.push_back(part);
+  }
+  _unsaved_files.push_back(_src.get());
+}
+
+void cxtranslationunit::reparse(
+  const environment& env_,
+  const unsaved_file& src_
+)
+{
+  update(env_, src_);
+
+  if (
+    clang_reparseTranslationUnit(
+      _tu,
+      _unsaved_files.size(),
+      &_unsaved_files[0],
+      clang_defaultReparseOptions(_tu)
+    ) != 0
+  )
+  {
+    throw
+      exception(
+        "Error reparsing source code (" + src_.filename() + ": "
+        + src_.content() + ")"
+      );
+  }
+}
+
 void cxtranslationunit::visit_nodes(const visitor& f_)
 {
   clang_visitChildren(
@@ -123,6 +225,21 @@ void cxtranslationunit::visit_nodes(const visitor& f_)
   );
 }
 
+cxcursor cxtranslationunit::cursor_at(unsigned int offset_) const
+{
+  return
+    cxcursor(
+      clang_getCursor(
+        _tu,
+        clang_getLocationForOffset(
+          _tu,
+          clang_getFile(_tu, _src.filename().c_str()),
+          offset_
+        )
+      )
+    );
+}
+
 cxtranslationunit::error_iterator cxtranslationunit::errors_begin() const
 {
   return
@@ -163,4 +280,46 @@ void cxtranslationunit::code_complete(std::set<std::string>& out_) const
   ).fill(out_);
 }
 
+std::vector<std::pair<std::string, unsigned long> >
+  cxtranslationunit::resource_usage() const
+{
+  std::vector<std::pair<std::string, unsigned long> > result;
+
+  CXTUResourceUsage usage = clang_getCXTUResourceUsage(_tu);
+  result.reserve(usage.numEntries);
+  for (unsigned int i = 0; i != usage.numEntries; ++i)
+  {
+    result.push_back(
+      std::make_pair(
+        std::string(clang_getTUResourceUsageName(usage.entries[i].kind)),
+        usage.entries[i].amount
+      )
+    );
+  }
+  clang_disposeCXTUResourceUsage(usage);
+
+  return result;
+}
+
+void cxtranslationunit::save(const std::string& filename_) const
+{
+  if (
+    clang_saveTranslationUnit(
+      _tu,
+      filename_.c_str(),
+      clang_defaultSaveOptions(_tu)
+    )
+    != CXSaveError_None
+  )
+  {
+    throw exception("Error saving translation unit to " + filename_);
+  }
+}
+
+std::vector<std::string> cxtranslationunit::included_files() const
+{
+  std::vector<std::string> result;
+  clang_getInclusions(_tu, inclusion_visitor, &result);
+  return result;
+}
 
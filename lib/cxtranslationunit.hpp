@@ -31,6 +31,7 @@
 #include <string>
 #include <set>
 #include <vector>
+#include <utility>
 #include <functional>
 
 namespace metashell
@@ -46,20 +47,54 @@ namespace metashell
     cxtranslationunit(
       const environment& env_,
       const unsaved_file& src_,
-      CXIndex index_
+      CXIndex index_,
+      unsigned options_ = CXTranslationUnit_None
     );
     ~cxtranslationunit();
 
+    // The main file has to start with this line to see the code of the
+    // environment. The code is passed to clang as unsaved headers, therefore
+    // the precompiled preamble of the main file contains the environment.
+    static std::string environment_include();
+
+    // Parses the translation unit again using the new content of the unsaved
+    // files. The clang arguments of env_ have to be the same as the ones the
+    // translation unit was created with.
+    void reparse(const environment& env_, const unsaved_file& src_);
+
+    // Replaces the unsaved files without parsing them. Useful when the next
+    // operation (eg. code completion) parses them anyway. The unsaved files
+    // refer to the code of env_, therefore it must not change until the
+    // next parse finishes.
+    void update(const environment& env_, const unsaved_file& src_);
+
     void visit_nodes(const visitor& f_);
 
+    // The cursor at the given offset of the main file. It is the declaration
+    // when the offset points to the name of the declared entity.
+    cxcursor cursor_at(unsigned int offset_) const;
+
     error_iterator errors_begin() const;
     error_iterator errors_end() const;
 
     bool has_errors() const;
 
     void code_complete(std::set<std::string>& out_) const;
+
+    // The memory used by libclang for this translation unit in bytes by
+    // the kind of memory
+    std::vector<std::pair<std::string, unsigned long> > resource_usage() const;
+
+    // Saves the translation unit as a precompiled header
+    void save(const std::string& filename_) const;
+
+    // The files included directly or indirectly by the main file
+    std::vector<std::string> included_files() const;
   private:
     unsaved_file _src;
+    // Includes the headers containing the parts of the environment
+    unsaved_file _env_header;
+    std::vector<std::string> _env_part_filenames;
     std::vector<CXUnsavedFile> _unsaved_files;
     CXTranslationUnit _tu;
   };
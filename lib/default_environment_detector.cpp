@@ -214,6 +214,12 @@ bool default_environment_detector::clang_binary_works_with_libclang(
   {
     header_file_environment env(cfg);
     env.append("struct foo {};");
+    env.finish_precompiling();
+    if (!env.get().empty())
+    {
+      // Precompiling the header failed
+      return false;
+    }
 
     cxindex index;
     std::unique_ptr<cxtranslationunit> tu = index.parse_code(src, env);
@@ -0,0 +1,121 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/default_pch.hpp>
+#include <metashell/in_memory_environment.hpp>
+#include <metashell/metashell.hpp>
+#include <metashell/standard.hpp>
+#include <metashell/unsaved_file.hpp>
+#include <metashell/version.hpp>
+#include <metashell/exception.hpp>
+
+#include "cxindex.hpp"
+#include "cxtranslationunit.hpp"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <memory>
+
+using namespace metashell;
+
+namespace
+{
+  // The header is never written to disk. It is an unsaved file when the
+  // precompiled header is built, therefore clang does not look for it when
+  // the precompiled header is used.
+  const char header_name[] = "metashell_default_environment.hpp";
+
+  std::string pch_file(const std::string& dir_, standard::type std_)
+  {
+    // Eg. "-std=c++0x" -> "c++0x"
+    const std::string arg = clang_argument(std_);
+    return
+      dir_ + "/default_environment_" + arg.substr(arg.find('=') + 1) + ".pch";
+  }
+
+  std::string version_file(const std::string& dir_)
+  {
+    return dir_ + "/version";
+  }
+
+  std::string versions()
+  {
+    return libclang_version() + "\n" + version() + "\n";
+  }
+}
+
+void metashell::build_default_pch(
+  const std::string& dir_,
+  const config& config_
+)
+{
+  // Throws when fails to create the directory
+  boost::filesystem::create_directories(dir_);
+
+  const standard::type standards[] = {standard::cpp11, standard::cpp14};
+  for (standard::type s : standards)
+  {
+    config cfg(config_);
+    cfg.standard_to_use = s;
+    const in_memory_environment env(dir_, cfg);
+
+    cxindex index(
+      CXTranslationUnit_Incomplete | CXTranslationUnit_ForSerialization
+    );
+    const std::unique_ptr<cxtranslationunit>
+      tu =
+        index.parse_code(unsaved_file(header_name, default_environment()), env);
+
+    if (tu->has_errors())
+    {
+      throw
+        exception(
+          "Error precompiling the default environment: " + *tu->errors_begin()
+        );
+    }
+
+    tu->save(pch_file(dir_, s));
+  }
+
+  std::ofstream f(version_file(dir_).c_str());
+  if (!(f << versions()))
+  {
+    throw exception("Error writing " + version_file(dir_));
+  }
+}
+
+std::string metashell::default_pch(const config& config_)
+{
+  if (config_.default_pch_dir.empty())
+  {
+    return std::string();
+  }
+
+  std::ifstream f(version_file(config_.default_pch_dir).c_str());
+  const std::string v(
+    (std::istreambuf_iterator<char>(f)),
+    std::istreambuf_iterator<char>()
+  );
+
+  const std::string pch =
+    pch_file(config_.default_pch_dir, config_.standard_to_use);
+
+  return
+    v == versions() && boost::filesystem::exists(pch) ? pch : std::string();
+}
+
@@ -0,0 +1,48 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/digest.hpp>
+
+#include <iomanip>
+#include <sstream>
+
+using namespace metashell;
+
+void digest::append(char c_)
+{
+  _sha1.process_byte(static_cast<unsigned char>(c_));
+}
+
+void digest::append(const std::string& s_)
+{
+  _sha1.process_bytes(s_.data(), s_.size());
+}
+
+std::string digest::value() const
+{
+  // get_digest finishes the calculation, therefore it works on a copy
+  boost::uuids::detail::sha1 sha1(_sha1);
+  unsigned int d[5];
+  sha1.get_digest(d);
+
+  std::ostringstream s;
+  s << std::hex << std::setfill('0');
+  for (unsigned int i : d)
+  {
+    s << std::setw(8) << i;
+  }
+  return s.str();
+}
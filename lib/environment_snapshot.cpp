@@ -0,0 +1,136 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/environment_snapshot.hpp>
+
+#include <metashell/exception.hpp>
+
+using namespace metashell;
+
+environment_snapshot::environment_snapshot(const environment& env_) :
+  _code(std::make_shared<const std::string>(env_.get())),
+  _digest(env_.get_digest()),
+  _clang_args(env_.clang_arguments()),
+  _headers(env_.get_headers()),
+  _all_digest(env_.get_all_digest())
+{}
+
+environment_snapshot::environment_snapshot(
+  std::shared_ptr<const std::string> code_,
+  const std::string& digest_,
+  const std::vector<std::string>& clang_args_,
+  const headers& headers_,
+  const std::string& all_digest_
+) :
+  _code(code_),
+  _digest(digest_),
+  _clang_args(clang_args_),
+  _headers(headers_),
+  _all_digest(all_digest_)
+{}
+
+void environment_snapshot::append(const std::string&)
+{
+  throw exception("The snapshot of an environment can not be extended.");
+}
+
+std::string environment_snapshot::get() const
+{
+  return *_code;
+}
+
+std::string environment_snapshot::get_appended(const std::string& s_) const
+{
+  // The appended code is separated by a new line, like in
+  // in_memory_environment
+  if (_code->empty())
+  {
+    return s_;
+  }
+  else
+  {
+    std::string result;
+    result.reserve(_code->size() + 1 + s_.size());
+    result += *_code;
+    result += '\n';
+    result += s_;
+    return result;
+  }
+}
+
+std::vector<boost::string_ref> environment_snapshot::get_parts() const
+{
+  std::vector<boost::string_ref> result;
+  if (!_code->empty())
+  {
+    result.push_back(*_code);
+  }
+  return result;
+}
+
+std::string environment_snapshot::get_digest() const
+{
+  return _digest;
+}
+
+std::string environment_snapshot::internal_dir() const
+{
+  return _headers.internal_dir();
+}
+
+std::vector<std::string>& environment_snapshot::clang_arguments()
+{
+  return _clang_args;
+}
+
+const std::vector<std::string>& environment_snapshot::clang_arguments() const
+{
+  return _clang_args;
+}
+
+const headers& environment_snapshot::get_headers() const
+{
+  return _headers;
+}
+
+std::string environment_snapshot::get_all() const
+{
+  return get();
+}
+
+std::string environment_snapshot::get_all_digest() const
+{
+  return _all_digest;
+}
+
+std::unique_ptr<environment> environment_snapshot::create_child() const
+{
+  return
+    std::unique_ptr<environment>(
+      new environment_snapshot(
+        _code,
+        _digest,
+        _clang_args,
+        _headers,
+        _all_digest
+      )
+    );
+}
+
+void environment_snapshot::refresh()
+{
+  // It never changes
+}
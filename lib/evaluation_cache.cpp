@@ -0,0 +1,126 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/evaluation_cache.hpp>
+#include <metashell/environment.hpp>
+#include <metashell/config.hpp>
+
+#include <cassert>
+
+using namespace metashell;
+
+evaluation_cache::evaluation_cache(int max_size_) :
+  _max_size(max_size_),
+  _hits(0),
+  _misses(0),
+  _entries(),
+  _index()
+{}
+
+boost::optional<result> evaluation_cache::find(
+  const environment& env_,
+  const config& config_,
+  const std::string& expression_
+)
+{
+  const auto i = _index.find(make_key(env_, config_, expression_));
+  if (i == _index.end())
+  {
+    ++_misses;
+    return boost::none;
+  }
+  else
+  {
+    ++_hits;
+    _entries.splice(_entries.begin(), _entries, i->second);
+    return i->second->second;
+  }
+}
+
+void evaluation_cache::add(
+  const environment& env_,
+  const config& config_,
+  const std::string& expression_,
+  const result& result_
+)
+{
+  if (_max_size > 0)
+  {
+    const key k = make_key(env_, config_, expression_);
+
+    const auto i = _index.find(k);
+    if (i == _index.end())
+    {
+      if (size() >= _max_size)
+      {
+        assert(!_entries.empty());
+
+        _index.erase(_entries.back().first);
+        _entries.pop_back();
+      }
+      _entries.push_front(std::make_pair(k, result_));
+      _index.insert(std::make_pair(k, _entries.begin()));
+    }
+    else
+    {
+      i->second->second = result_;
+      _entries.splice(_entries.begin(), _entries, i->second);
+    }
+  }
+}
+
+void evaluation_cache::clear()
+{
+  _entries.clear();
+  _index.clear();
+  _hits = 0;
+  _misses = 0;
+}
+
+int evaluation_cache::max_size() const
+{
+  return _max_size;
+}
+
+int evaluation_cache::size() const
+{
+  return _index.size();
+}
+
+int evaluation_cache::hits() const
+{
+  return _hits;
+}
+
+int evaluation_cache::misses() const
+{
+  return _misses;
+}
+
+evaluation_cache::key evaluation_cache::make_key(
+  const environment& env_,
+  const config& config_,
+  const std::string& expression_
+)
+{
+  return
+    key(
+      env_.get_all_digest(),
+      env_.clang_arguments(),
+      config_.verbose,
+      expression_
+    );
+}
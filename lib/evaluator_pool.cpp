@@ -0,0 +1,1228 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/evaluator_pool.hpp>
+#include <metashell/environment_snapshot.hpp>
+#include <metashell/default_environment_detector.hpp>
+#include <metashell/exception.hpp>
+#include <metashell/headers.hpp>
+#include <metashell/metashell.hpp>
+#include <metashell/timing.hpp>
+
+#include "cxindex.hpp"
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <poll.h>
+#  include <signal.h>
+#  include <sys/resource.h>
+#  include <sys/types.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <new>
+#include <sstream>
+
+using namespace metashell;
+
+namespace
+{
+  // The workers run the executable of the shell with this argument
+  const char worker_arg[] = "--evaluator_process";
+
+  std::string& shell_executable()
+  {
+    static std::string path;
+    return path;
+  }
+}
+
+#ifndef _WIN32
+
+namespace
+{
+  // The messages between the shell and the workers are lists of strings
+  typedef std::vector<std::string> message;
+
+  enum read_status
+  {
+    read_ok,
+    read_closed,
+    read_timeout,
+    read_cancelled
+  };
+
+  // What reading a message waits for besides the data. A timeout_sec of 0
+  // means no timeout, a null cancelled means that it can not be cancelled.
+  struct read_limits
+  {
+    int timeout_sec;
+    std::chrono::steady_clock::time_point start;
+    const std::atomic<bool>* cancelled;
+  };
+
+  // The cancellation flag may be set by a signal handler, which can not
+  // wake poll up, therefore it is checked this often.
+  const int cancel_check_ms = 50;
+
+  const std::string eval_request("eval");
+  const std::string eval_all_request("eval_all");
+  const std::string validate_request("validate");
+  const std::string complete_request("complete");
+
+  // Fields of the requests. The environment is sent once: the code passed
+  // to clang before the code of the request, its digests, the headers and
+  // the clang arguments. The worker keeps the code of the last environment
+  // it received, the code is sent only when the worker does not have it
+  // (request_env_code_sent is 1 then).
+  const int request_kind = 0;
+  const int request_input_filename = 1;
+  const int request_verbose = 2;
+  const int request_declarations_only = 3;
+  const int request_env_code_sent = 4;
+  const int request_env_code = 5;
+  const int request_env_digest = 6;
+  const int request_env_all_digest = 7;
+  const int request_env_internal_dir = 8;
+  const int request_env_no_headers = 9;
+  const int request_env_clang_arg_count = 10;
+  // The clang arguments followed by the code of the request. An eval_all
+  // request has one field for each metaprogram, the rest have one field.
+  const int request_env_clang_args = 11;
+
+  // Fields of the responses
+  const int response_output = 0;
+  const int response_info = 1;
+  const int response_resource_limit_exceeded = 2;
+  const int response_exception = 3;
+  // The stages and the resource usage recorded by the worker
+  const int response_timing = 4;
+  // The rest of the fields: the errors of a result, the results of an
+  // eval_all request or the candidates of a code completion
+  const message::size_type response_payload = 5;
+
+  std::string bool_to_string(bool b_)
+  {
+    return b_ ? "1" : "0";
+  }
+
+  bool write_all(int fd_, const char* buff_, size_t len_)
+  {
+    while (len_ > 0)
+    {
+      const ssize_t written = ::write(fd_, buff_, len_);
+      if (written < 0)
+      {
+        if (errno != EINTR)
+        {
+          return false;
+        }
+      }
+      else
+      {
+        buff_ += written;
+        len_ -= written;
+      }
+    }
+    return true;
+  }
+
+  read_status read_all(
+    int fd_,
+    char* buff_,
+    size_t len_,
+    const read_limits& limits_
+  )
+  {
+    using std::chrono::duration_cast;
+    using std::chrono::milliseconds;
+    using std::chrono::seconds;
+    using std::chrono::steady_clock;
+
+    while (len_ > 0)
+    {
+      if (limits_.timeout_sec > 0 || limits_.cancelled)
+      {
+        int wait_ms = -1;
+        if (limits_.timeout_sec > 0)
+        {
+          wait_ms =
+            duration_cast<milliseconds>(
+              limits_.start + seconds(limits_.timeout_sec) - steady_clock::now()
+            ).count();
+          if (wait_ms <= 0)
+          {
+            return read_timeout;
+          }
+        }
+        if (limits_.cancelled)
+        {
+          if (*limits_.cancelled)
+          {
+            return read_cancelled;
+          }
+          else if (wait_ms < 0 || wait_ms > cancel_check_ms)
+          {
+            wait_ms = cancel_check_ms;
+          }
+        }
+
+        pollfd p;
+        p.fd = fd_;
+        p.events = POLLIN;
+        p.revents = 0;
+        const int ready = poll(&p, 1, wait_ms);
+        if (ready == 0)
+        {
+          continue;
+        }
+        else if (ready < 0)
+        {
+          if (errno == EINTR)
+          {
+            continue;
+          }
+          return read_closed;
+        }
+      }
+
+      const ssize_t len = ::read(fd_, buff_, len_);
+      if (len < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      else if (len <= 0)
+      {
+        return read_closed;
+      }
+      buff_ += len;
+      len_ -= len;
+    }
+    return read_ok;
+  }
+
+  void append_number(std::string& buff_, std::uint32_t n_)
+  {
+    for (int i = 0; i != 4; ++i)
+    {
+      buff_ += char((n_ >> (8 * i)) & 0xff);
+    }
+  }
+
+  read_status read_number(int fd_, std::uint32_t& n_, const read_limits& l_)
+  {
+    unsigned char buff[4];
+    const read_status s = read_all(fd_, reinterpret_cast<char*>(buff), 4, l_);
+    n_ =
+      std::uint32_t(buff[0])
+      | (std::uint32_t(buff[1]) << 8)
+      | (std::uint32_t(buff[2]) << 16)
+      | (std::uint32_t(buff[3]) << 24);
+    return s;
+  }
+
+  bool write_message(int fd_, const message& m_)
+  {
+    std::string buff;
+    append_number(buff, m_.size());
+    for (const std::string& s : m_)
+    {
+      append_number(buff, s.size());
+      buff += s;
+    }
+    return write_all(fd_, buff.data(), buff.size());
+  }
+
+  read_status read_message(
+    int fd_,
+    message& m_,
+    int timeout_sec_,
+    const std::atomic<bool>* cancelled_
+  )
+  {
+    const read_limits
+      limits = { timeout_sec_, std::chrono::steady_clock::now(), cancelled_ };
+
+    m_.clear();
+
+    std::uint32_t count = 0;
+    read_status s = read_number(fd_, count, limits);
+    for (std::uint32_t i = 0; i != count && s == read_ok; ++i)
+    {
+      std::uint32_t len = 0;
+      s = read_number(fd_, len, limits);
+      if (s == read_ok)
+      {
+        std::string str(len, '\0');
+        if (len > 0)
+        {
+          s = read_all(fd_, &str[0], len, limits);
+        }
+        m_.push_back(str);
+      }
+    }
+    return s;
+  }
+
+  message make_request(
+    const std::string& kind_,
+    const std::vector<std::string>& code_,
+    const std::string& input_filename_,
+    const config& config_,
+    const environment& env_,
+    bool declarations_only_ = false
+  )
+  {
+    const std::vector<std::string>& args = env_.clang_arguments();
+
+    message m(request_env_clang_args);
+    m.reserve(request_env_clang_args + args.size() + code_.size());
+    m[request_kind] = kind_;
+    m[request_input_filename] = input_filename_;
+    m[request_verbose] = bool_to_string(config_.verbose);
+    m[request_declarations_only] = bool_to_string(declarations_only_);
+    // Filled by the worker when needed
+    m[request_env_code_sent] = bool_to_string(false);
+    m[request_env_digest] = env_.get_digest();
+    m[request_env_all_digest] = env_.get_all_digest();
+    m[request_env_internal_dir] = env_.internal_dir();
+    m[request_env_no_headers] = bool_to_string(env_.get_headers().size() == 0);
+    m[request_env_clang_arg_count] = std::to_string(args.size());
+    m.insert(m.end(), args.begin(), args.end());
+    m.insert(m.end(), code_.begin(), code_.end());
+    return m;
+  }
+
+  // A copy of request_ containing the code of the environment
+  message with_environment_code(
+    const message& request_,
+    const environment& env_
+  )
+  {
+    std::string code;
+    for (const boost::string_ref& part : env_.get_parts())
+    {
+      code.append(part.begin(), part.end());
+    }
+
+    message m(request_);
+    m[request_env_code_sent] = bool_to_string(true);
+    m[request_env_code].swap(code);
+    return m;
+  }
+
+  message make_request(
+    const std::string& kind_,
+    const std::string& code_,
+    const std::string& input_filename_,
+    const config& config_,
+    const environment& env_,
+    bool declarations_only_ = false
+  )
+  {
+    return
+      make_request(
+        kind_,
+        std::vector<std::string>(1, code_),
+        input_filename_,
+        config_,
+        env_,
+        declarations_only_
+      );
+  }
+
+  // One line for each stage ("s <ms> <name>") and resource
+  // ("r <bytes> <name>")
+  std::string timing_to_string(const timing& t_)
+  {
+    std::ostringstream s;
+    s << std::setprecision(17);
+    for (const std::pair<std::string, double>& st : t_.get_stages())
+    {
+      s << "s " << st.second << " " << st.first << "\n";
+    }
+    for (const std::pair<std::string, unsigned long>& r : t_.get_resources())
+    {
+      s << "r " << r.second << " " << r.first << "\n";
+    }
+    return s.str();
+  }
+
+  timing timing_from_string(const std::string& s_)
+  {
+    timing t;
+    std::istringstream s(s_);
+    for (std::string line; std::getline(s, line); )
+    {
+      std::istringstream l(line);
+      char kind;
+      double ms;
+      unsigned long bytes;
+      std::string name;
+      if (
+        l >> kind
+        && (kind == 's' ? bool(l >> ms) : kind == 'r' && l >> bytes)
+        && l.get() == ' '
+        && std::getline(l, name)
+      )
+      {
+        if (kind == 's')
+        {
+          t.add_stage(name, ms);
+        }
+        else
+        {
+          t.add_resource_usage(name, bytes);
+        }
+      }
+      else
+      {
+        throw exception("Invalid response from the evaluator process.");
+      }
+    }
+    return t;
+  }
+
+  // Appends the output, the info, the resource limit flag and the errors
+  // of r_. The number of errors is not stored.
+  void append_result(message& m_, const result& r_)
+  {
+    m_.push_back(r_.output);
+    m_.push_back(r_.info);
+    m_.push_back(bool_to_string(r_.resource_limit_exceeded));
+  }
+
+  message make_response(const result& r_, const std::string& exception_)
+  {
+    message m;
+    append_result(m, r_);
+    m.push_back(exception_);
+    // Filled by the main loop of the worker
+    m.push_back("");
+    m.insert(m.end(), r_.errors.begin(), r_.errors.end());
+    return m;
+  }
+
+  message make_response(const std::vector<result>& rs_)
+  {
+    result summary;
+    for (const result& r : rs_)
+    {
+      summary.resource_limit_exceeded =
+        summary.resource_limit_exceeded || r.resource_limit_exceeded;
+    }
+
+    message m = make_response(summary, "");
+    for (const result& r : rs_)
+    {
+      append_result(m, r);
+      m.push_back(std::to_string(r.errors.size()));
+      m.insert(m.end(), r.errors.begin(), r.errors.end());
+    }
+    return m;
+  }
+
+  message make_response(const std::set<std::string>& candidates_)
+  {
+    message m = make_response(result(), "");
+    m.insert(m.end(), candidates_.begin(), candidates_.end());
+    return m;
+  }
+
+  result resource_limit_exceeded(const std::string& reason_)
+  {
+    const std::string errors[] = {"Resource limit exceeded: " + reason_};
+    result r("", errors, errors + sizeof(errors) / sizeof(errors[0]), "");
+    r.resource_limit_exceeded = true;
+    return r;
+  }
+
+  // Reads a result from the payload of an eval_all response
+  result read_result(message::const_iterator& i_, message::const_iterator e_)
+  {
+    if (e_ - i_ < 4)
+    {
+      throw exception("Invalid response from the evaluator process.");
+    }
+    const std::string& output = *i_++;
+    const std::string& info = *i_++;
+    const bool limit_exceeded = *i_++ == "1";
+    const std::string::size_type error_count = std::stoul(*i_++);
+    if (std::string::size_type(e_ - i_) < error_count)
+    {
+      throw exception("Invalid response from the evaluator process.");
+    }
+
+    result r(output, i_, i_ + error_count, info);
+    r.resource_limit_exceeded = limit_exceeded;
+    i_ += error_count;
+    return r;
+  }
+
+  // The environment a worker process received last
+  struct received_environment
+  {
+    std::shared_ptr<const std::string> code;
+    std::string digest;
+  };
+
+  message process(
+    cxindex& index_,
+    cxindex& declaration_index_,
+    received_environment& env_,
+    const message& request_
+  )
+  {
+    if (request_.size() < message::size_type(request_env_clang_args))
+    {
+      throw exception("Invalid request sent to the evaluator process.");
+    }
+    const message::const_iterator
+      args_begin = request_.begin() + request_env_clang_args;
+    const message::size_type
+      arg_count = std::stoul(request_[request_env_clang_arg_count]);
+    if (message::size_type(request_.end() - args_begin) < arg_count + 1)
+    {
+      throw exception("Invalid request sent to the evaluator process.");
+    }
+    const message::const_iterator code_begin = args_begin + arg_count;
+
+    if (request_[request_env_code_sent] == "1")
+    {
+      env_.code =
+        std::make_shared<const std::string>(request_[request_env_code]);
+      env_.digest = request_[request_env_digest];
+    }
+    else if (!env_.code || env_.digest != request_[request_env_digest])
+    {
+      throw exception("Invalid request sent to the evaluator process.");
+    }
+
+    const headers
+      hdrs(
+        request_[request_env_internal_dir],
+        request_[request_env_no_headers] == "1"
+      );
+    const environment_snapshot
+      env(
+        env_.code,
+        env_.digest,
+        std::vector<std::string>(args_begin, code_begin),
+        hdrs,
+        request_[request_env_all_digest]
+      );
+
+    config cfg;
+    cfg.verbose = request_[request_verbose] == "1";
+
+    const std::string& kind = request_[request_kind];
+    const std::string& code = *code_begin;
+    const std::string& input_filename = request_[request_input_filename];
+
+    if (kind == eval_request)
+    {
+      return
+        make_response(
+          eval_tmp_formatted(index_, env, code, cfg, input_filename),
+          ""
+        );
+    }
+    else if (kind == eval_all_request)
+    {
+      return
+        make_response(
+          eval_tmp_formatted(
+            index_,
+            env,
+            std::vector<std::string>(code_begin, request_.end()),
+            cfg,
+            input_filename
+          )
+        );
+    }
+    else if (kind == validate_request)
+    {
+      return
+        make_response(
+          validate_code(
+            request_[request_declarations_only] == "1" ?
+              declaration_index_ :
+              index_,
+            code,
+            cfg,
+            env,
+            input_filename
+          ),
+          ""
+        );
+    }
+    else if (kind == complete_request)
+    {
+      std::set<std::string> candidates;
+      code_complete(index_, env, code, input_filename, candidates);
+      return make_response(candidates);
+    }
+    else
+    {
+      throw exception("Invalid request sent to the evaluator process.");
+    }
+  }
+
+  // The main loop of a worker process
+  void serve(int in_, int out_)
+  {
+    cxindex index;
+    cxindex
+      declaration_index(
+        CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_Incomplete
+      );
+    received_environment env;
+    for (message request; read_message(in_, request, 0, nullptr) == read_ok; )
+    {
+      // The shell adds the time spent in the stages in the worker to its
+      // own timing
+      timing t;
+      timing_recorder recorder(t);
+
+      message response;
+      try
+      {
+        response = process(index, declaration_index, env, request);
+      }
+      catch (const std::bad_alloc&)
+      {
+        response =
+          make_response(
+            resource_limit_exceeded("the evaluation ran out of memory"),
+            ""
+          );
+      }
+      catch (const std::exception& e)
+      {
+        response = make_response(result(), e.what());
+      }
+      catch (...)
+      {
+        response = make_response(result(), "Unknown error");
+      }
+      response[response_timing] = timing_to_string(t);
+
+      // The state of the process is unknown after running out of memory,
+      // therefore it stops and the shell replaces it.
+      if (
+        !write_message(out_, response)
+        || response[response_resource_limit_exceeded] == "1"
+      )
+      {
+        return;
+      }
+    }
+  }
+
+  // The pipes are not inherited by the other processes the shell starts
+  // (eg. the other workers), otherwise a worker would not notice that the
+  // shell has closed its end.
+  bool create_pipe(int (&fds_)[2])
+  {
+#ifdef __linux__
+    return pipe2(fds_, O_CLOEXEC) == 0;
+#else
+    if (pipe(fds_) != 0)
+    {
+      return false;
+    }
+    fcntl(fds_[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds_[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+  }
+}
+
+class evaluator_pool::worker : boost::noncopyable
+{
+public:
+  worker(const std::string& binary_, int memory_limit_mb_) :
+    _pid(-1),
+    _to_child(-1),
+    _from_child(-1),
+    _served(0),
+    _alive(true),
+    _env_digest()
+  {
+    int to_child[2];
+    int from_child[2];
+    if (!create_pipe(to_child))
+    {
+      throw exception("Failed to create a pipe for an evaluator process.");
+    }
+    if (!create_pipe(from_child))
+    {
+      close(to_child[0]);
+      close(to_child[1]);
+      throw exception("Failed to create a pipe for an evaluator process.");
+    }
+
+    // The shell may be running other threads, therefore the child calls
+    // only async-signal-safe functions before exec. Everything it needs is
+    // prepared here.
+    const char* const argv[] = { binary_.c_str(), worker_arg, nullptr };
+    rlimit limit;
+    limit.rlim_cur = limit.rlim_max = rlim_t(memory_limit_mb_) * 1024 * 1024;
+
+    _pid = fork();
+    if (_pid < 0)
+    {
+      close(to_child[0]);
+      close(to_child[1]);
+      close(from_child[0]);
+      close(from_child[1]);
+      throw exception("Failed to start an evaluator process.");
+    }
+    else if (_pid == 0)
+    {
+      // Ctrl-C in the terminal reaches only the shell. It kills the worker
+      // running the cancelled evaluation.
+      setpgid(0, 0);
+
+      // Set before exec, so it limits the new executable, not the address
+      // space of the shell copied by fork
+      if (memory_limit_mb_ > 0)
+      {
+        setrlimit(RLIMIT_AS, &limit);
+      }
+
+      // dup2 clears close-on-exec on the copies
+      dup2(to_child[0], STDIN_FILENO);
+      dup2(from_child[1], STDOUT_FILENO);
+      execv(argv[0], const_cast<char* const*>(argv));
+      _exit(127);
+    }
+    else
+    {
+      close(to_child[0]);
+      close(from_child[1]);
+      _to_child = to_child[1];
+      _from_child = from_child[0];
+    }
+  }
+
+  ~worker()
+  {
+    close(_to_child);
+    close(_from_child);
+    if (_pid > 0)
+    {
+      kill(_pid, SIGKILL);
+      waitpid(_pid, 0, 0);
+    }
+  }
+
+  // When the status is not read_ok, the worker has been stopped and
+  // failure_ describes what happened to it.
+  read_status run(
+    const message& request_,
+    const environment& env_,
+    message& response_,
+    std::string& failure_,
+    int timeout_sec_,
+    int memory_limit_mb_,
+    const std::atomic<bool>* cancelled_
+  )
+  {
+    ++_served;
+
+    const bool send_env = _env_digest != request_[request_env_digest];
+    const read_status
+      s =
+        write_message(
+          _to_child,
+          send_env ? with_environment_code(request_, env_) : request_
+        ) ?
+          read_message(_from_child, response_, timeout_sec_, cancelled_) :
+          read_closed;
+
+    if (s == read_ok && response_.size() >= response_payload)
+    {
+      if (send_env)
+      {
+        _env_digest = request_[request_env_digest];
+      }
+      // The worker stops after running out of memory
+      _alive = response_[response_resource_limit_exceeded] != "1";
+      return read_ok;
+    }
+    else
+    {
+      const std::string status = stop();
+      if (s == read_timeout)
+      {
+        failure_ =
+          "the evaluation did not finish in " + std::to_string(timeout_sec_)
+          + " seconds";
+      }
+      else
+      {
+        failure_ = status;
+        if (memory_limit_mb_ > 0)
+        {
+          failure_ +=
+            " (memory limit: " + std::to_string(memory_limit_mb_) + " MB)";
+        }
+      }
+      return s == read_ok ? read_closed : s;
+    }
+  }
+
+  bool alive() const
+  {
+    return _alive;
+  }
+
+  int served() const
+  {
+    return _served;
+  }
+private:
+  pid_t _pid;
+  int _to_child;
+  int _from_child;
+  int _served;
+  bool _alive;
+  // The digest of the code of the environment the process has
+  std::string _env_digest;
+
+  // Kills the process and describes how it terminated. It may have
+  // terminated already (eg. crashed).
+  std::string stop()
+  {
+    _alive = false;
+
+    kill(_pid, SIGKILL);
+    int status = 0;
+    while (waitpid(_pid, &status, 0) < 0 && errno == EINTR) {}
+    _pid = -1;
+
+    std::ostringstream s;
+    if (WIFSIGNALED(status))
+    {
+      s
+        << "the evaluator process was terminated by signal "
+        << WTERMSIG(status) << " (" << strsignal(WTERMSIG(status)) << ")";
+    }
+    else
+    {
+      s
+        << "the evaluator process exited with code " << WEXITSTATUS(status);
+    }
+    return s.str();
+  }
+};
+
+evaluator_pool::evaluator_pool(const config& config_) :
+  _binary(shell_executable()),
+  _processes(config_.evaluator_processes),
+  _memory_limit_mb(config_.evaluator_memory_limit_mb),
+  _timeout_sec(config_.evaluator_timeout_sec),
+  _queries_per_process(config_.evaluator_queries_per_process)
+{
+  if (_binary.empty())
+  {
+    throw
+      exception(
+        "Evaluator processes can not be started, because"
+        " evaluator_pool::run_worker was not called from main."
+      );
+  }
+
+  // Writing to the pipe of a crashed worker should not kill the shell
+  signal(SIGPIPE, SIG_IGN);
+
+  for (int i = 0; i < _processes; ++i)
+  {
+    _idle.push_back(new_worker());
+  }
+}
+
+evaluator_pool::~evaluator_pool() {}
+
+void evaluator_pool::reserve(int processes_)
+{
+  int missing;
+  {
+    std::lock_guard<std::mutex> l(_lock);
+    missing = processes_ - _processes;
+    _processes = std::max(_processes, processes_);
+  }
+
+  // The workers are started outside of the lock, they take time
+  std::vector<std::unique_ptr<worker>> started;
+  for (int i = 0; i < missing; ++i)
+  {
+    started.push_back(new_worker());
+  }
+
+  std::lock_guard<std::mutex> l(_lock);
+  for (std::unique_ptr<worker>& w : started)
+  {
+    _idle.push_back(std::move(w));
+  }
+}
+
+bool evaluator_pool::run(
+  const std::vector<std::string>& request_,
+  const environment& env_,
+  std::vector<std::string>& response_,
+  std::string& failure_,
+  const std::atomic<bool>* cancelled_
+)
+{
+  timed_stage t("evaluator process");
+
+  std::unique_ptr<worker> w;
+  {
+    std::lock_guard<std::mutex> l(_lock);
+    if (!_idle.empty())
+    {
+      w = std::move(_idle.back());
+      _idle.pop_back();
+    }
+  }
+  if (!w)
+  {
+    // All of the workers are busy (eg. evaluating in parallel)
+    w = new_worker();
+  }
+
+  const read_status
+    s =
+      w->run(
+        request_,
+        env_,
+        response_,
+        failure_,
+        _timeout_sec,
+        _memory_limit_mb,
+        cancelled_
+      );
+  give_back(std::move(w));
+
+  if (s == read_ok)
+  {
+    failure_.clear();
+    if (timing* t = timing_recorder::current())
+    {
+      t->add(timing_from_string(response_[response_timing]));
+    }
+  }
+  else
+  {
+    response_.clear();
+  }
+  return s != read_cancelled;
+}
+
+boost::optional<result> evaluator_pool::run_for_result(
+  const std::vector<std::string>& request_,
+  const environment& env_,
+  const std::atomic<bool>* cancelled_
+)
+{
+  message response;
+  std::string failure;
+  if (!run(request_, env_, response, failure, cancelled_))
+  {
+    return boost::none;
+  }
+  else if (!failure.empty())
+  {
+    return resource_limit_exceeded(failure);
+  }
+  else if (!response[response_exception].empty())
+  {
+    throw exception(response[response_exception]);
+  }
+  else
+  {
+    result
+      r(
+        response[response_output],
+        response.begin() + response_payload,
+        response.end(),
+        response[response_info]
+      );
+    r.resource_limit_exceeded =
+      response[response_resource_limit_exceeded] == "1";
+    return r;
+  }
+}
+
+std::unique_ptr<evaluator_pool::worker> evaluator_pool::new_worker() const
+{
+  return std::unique_ptr<worker>(new worker(_binary, _memory_limit_mb));
+}
+
+void evaluator_pool::give_back(std::unique_ptr<worker> worker_)
+{
+  if (
+    !worker_->alive()
+    || (_queries_per_process > 0 && worker_->served() >= _queries_per_process)
+  )
+  {
+    // Start the replacement now, so the next query does not wait for it
+    worker_.reset();
+    worker_ = new_worker();
+  }
+
+  std::lock_guard<std::mutex> l(_lock);
+  if (_idle.size() < std::vector<worker*>::size_type(_processes))
+  {
+    _idle.push_back(std::move(worker_));
+  }
+}
+
+boost::optional<result> evaluator_pool::eval_tmp_formatted(
+  const environment& env_,
+  const std::string& tmp_exp_,
+  const config& config_,
+  const std::string& input_filename_,
+  const std::atomic<bool>* cancelled_
+)
+{
+  return
+    run_for_result(
+      make_request(eval_request, tmp_exp_, input_filename_, config_, env_),
+      env_,
+      cancelled_
+    );
+}
+
+boost::optional<std::vector<result>> evaluator_pool::eval_tmp_formatted(
+  const environment& env_,
+  const std::vector<std::string>& tmp_exps_,
+  const config& config_,
+  const std::string& input_filename_,
+  const std::atomic<bool>* cancelled_
+)
+{
+  message response;
+  std::string failure;
+  if (
+    !run(
+      make_request(eval_all_request, tmp_exps_, input_filename_, config_, env_),
+      env_,
+      response,
+      failure,
+      cancelled_
+    )
+  )
+  {
+    return boost::none;
+  }
+  else if (!failure.empty())
+  {
+    return
+      std::vector<result>(tmp_exps_.size(), resource_limit_exceeded(failure));
+  }
+  else if (!response[response_exception].empty())
+  {
+    throw exception(response[response_exception]);
+  }
+  else
+  {
+    std::vector<result> rs;
+    rs.reserve(tmp_exps_.size());
+    message::const_iterator i = response.begin() + response_payload;
+    while (i != response.end())
+    {
+      rs.push_back(read_result(i, response.end()));
+    }
+    if (rs.size() != tmp_exps_.size())
+    {
+      throw exception("Invalid response from the evaluator process.");
+    }
+    return rs;
+  }
+}
+
+boost::optional<result> evaluator_pool::validate_code(
+  const std::string& s_,
+  const config& config_,
+  const environment& env_,
+  const std::string& input_filename_,
+  bool declarations_only_,
+  const std::atomic<bool>* cancelled_
+)
+{
+  return
+    run_for_result(
+      make_request(
+        validate_request,
+        s_,
+        input_filename_,
+        config_,
+        env_,
+        declarations_only_
+      ),
+      env_,
+      cancelled_
+    );
+}
+
+void evaluator_pool::code_complete(
+  const environment& env_,
+  const std::string& src_,
+  const std::string& input_filename_,
+  std::set<std::string>& out_
+)
+{
+  out_.clear();
+
+  message response;
+  std::string failure;
+  run(
+    make_request(complete_request, src_, input_filename_, config(), env_),
+    env_,
+    response,
+    failure,
+    nullptr
+  );
+  // A failed completion has no candidates
+  if (failure.empty() && response[response_exception].empty())
+  {
+    out_.insert(response.begin() + response_payload, response.end());
+  }
+}
+
+#else
+
+class evaluator_pool::worker {};
+
+evaluator_pool::evaluator_pool(const config&) :
+  _binary(),
+  _processes(0),
+  _memory_limit_mb(0),
+  _timeout_sec(0),
+  _queries_per_process(0)
+{
+  throw exception("Evaluator processes are not supported on this platform.");
+}
+
+evaluator_pool::~evaluator_pool() {}
+
+void evaluator_pool::reserve(int) {}
+
+bool evaluator_pool::run(
+  const std::vector<std::string>&,
+  const environment&,
+  std::vector<std::string>&,
+  std::string&,
+  const std::atomic<bool>*
+)
+{
+  return false;
+}
+
+boost::optional<result> evaluator_pool::run_for_result(
+  const std::vector<std::string>&,
+  const environment&,
+  const std::atomic<bool>*
+)
+{
+  return boost::none;
+}
+
+std::unique_ptr<evaluator_pool::worker> evaluator_pool::new_worker() const
+{
+  return std::unique_ptr<worker>();
+}
+
+void evaluator_pool::give_back(std::unique_ptr<worker>)
+{}
+
+boost::optional<result> evaluator_pool::eval_tmp_formatted(
+  const environment&,
+  const std::string&,
+  const config&,
+  const std::string&,
+  const std::atomic<bool>*
+)
+{
+  return boost::none;
+}
+
+boost::optional<std::vector<result>> evaluator_pool::eval_tmp_formatted(
+  const environment&,
+  const std::vector<std::string>&,
+  const config&,
+  const std::string&,
+  const std::atomic<bool>*
+)
+{
+  return boost::none;
+}
+
+boost::optional<result> evaluator_pool::validate_code(
+  const std::string&,
+  const config&,
+  const environment&,
+  const std::string&,
+  bool,
+  const std::atomic<bool>*
+)
+{
+  return boost::none;
+}
+
+void evaluator_pool::code_complete(
+  const environment&,
+  const std::string&,
+  const std::string&,
+  std::set<std::string>&
+)
+{}
+
+#endif
+
+boost::optional<int> evaluator_pool::run_worker(
+  int argc_,
+  const char* const argv_[]
+)
+{
+#ifndef _WIN32
+  if (argc_ == 2 && argv_[1] == std::string(worker_arg))
+  {
+    // Only the responses are written to the standard output. Anything else
+    // the worker displays goes to the standard error.
+    const int out = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    serve(STDIN_FILENO, out);
+    return 0;
+  }
+#endif
+
+  shell_executable() =
+    default_environment_detector(argc_ > 0 ? argv_[0] : "")
+      .path_of_executable();
+  return boost::none;
+}
+
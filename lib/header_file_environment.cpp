@@ -19,13 +19,29 @@
 #include <metashell/config.hpp>
 #include <metashell/clang_binary.hpp>
 #include <metashell/exception.hpp>
+#include <metashell/pch_cache.hpp>
+#include <metashell/default_pch.hpp>
+#include <metashell/metashell.hpp>
+#include <metashell/environment_snapshot.hpp>
+#include <metashell/unsaved_file.hpp>
+#include <metashell/digest.hpp>
+
+#include "cxindex.hpp"
+#include "cxstring.hpp"
+#include "cxtranslationunit.hpp"
 
 #include <just/process.hpp>
 
 #include <boost/algorithm/string/trim.hpp>
 
+#include <cassert>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
 #include <vector>
 
 using namespace metashell;
@@ -33,6 +49,25 @@ using namespace metashell;
 namespace
 {
   const char env_fn[] = "metashell_environment.hpp";
+  const std::string include_env = "#include <" + std::string(env_fn) + ">\n";
+
+  // The chain of precompiled headers is replaced by one precompiled header
+  // containing the entire environment when it reaches this length, because
+  // every parse has to read all of them.
+  const std::vector<std::string>::size_type max_pch_chain_length = 32;
+
+  void write_file(const std::string& fn_, const std::string& content_)
+  {
+    std::ofstream f(fn_.c_str());
+    if (f)
+    {
+      f << content_;
+    }
+    else
+    {
+      throw exception("Error saving environment to " + fn_);
+    }
+  }
 
   void extend_to_find_headers_in_local_dir(std::vector<std::string>& v_)
   {
@@ -43,7 +78,8 @@ namespace
   void precompile(
     const std::string& clang_path_,
     const std::vector<std::string>& clang_args_,
-    const std::string& fn_
+    const std::string& fn_,
+    const std::string& pch_
   )
   {
     using boost::algorithm::trim_copy;
@@ -52,7 +88,7 @@ namespace
     extend_to_find_headers_in_local_dir(args);
     args.push_back("-w");
     args.push_back("-o");
-    args.push_back(fn_ + ".pch");
+    args.push_back(pch_);
     args.push_back(fn_);
 
     const just::process::output o = clang_binary(clang_path_).run(args);
@@ -67,41 +103,255 @@ namespace
       throw exception("Error precompiling header " + fn_ + ": " + err);
     }
   }
+
+  std::string escape_in_rule(const std::string& path_)
+  {
+    std::string result;
+    for (char c : path_)
+    {
+      if (c == ' ')
+      {
+        result += '\\';
+      }
+      result += c;
+    }
+    return result;
+  }
+
+  // The precompiled header is built from the translation unit parsed by
+  // libclang. The dependencies are collected from the translation unit,
+  // since libclang does not write them.
+  void precompile_in_process(
+    const std::vector<std::string>& clang_args_,
+    const std::string& fn_,
+    const std::string& pch_
+  )
+  {
+    std::vector<std::string> args;
+    std::string rule_file;
+    for (auto i = clang_args_.begin(), e = clang_args_.end(); i != e; ++i)
+    {
+      if (*i == "-MF" && i + 1 != e)
+      {
+        ++i;
+        rule_file = *i;
+      }
+      else if (*i != "-MD")
+      {
+        args.push_back(*i);
+      }
+    }
+    extend_to_find_headers_in_local_dir(args);
+    args.push_back("-w");
+
+    std::ifstream f(fn_.c_str());
+    const std::string content(
+      (std::istreambuf_iterator<char>(f)),
+      std::istreambuf_iterator<char>()
+    );
+
+    const environment_snapshot
+      env(std::make_shared<std::string>(), "", args, headers("", true), "");
+
+    cxindex index(
+      CXTranslationUnit_Incomplete | CXTranslationUnit_ForSerialization
+    );
+    const std::unique_ptr<cxtranslationunit>
+      tu = index.parse_code(unsaved_file(fn_, content), env);
+
+    if (tu->has_errors())
+    {
+      throw
+        exception(
+          "Error precompiling header " + fn_ + ": " + *tu->errors_begin()
+        );
+    }
+
+    tu->save(pch_);
+
+    if (!rule_file.empty())
+    {
+      std::ostringstream rule;
+      rule << escape_in_rule(pch_) << ": " << escape_in_rule(fn_);
+      for (const std::string& included : tu->included_files())
+      {
+        rule << " \\\n  " << escape_in_rule(included);
+      }
+      rule << "\n";
+      write_file(rule_file, rule.str());
+    }
+  }
+
+  pch_cache::precompiler create_precompiler(const config& config_)
+  {
+    if (config_.precompile_in_process)
+    {
+      return precompile_in_process;
+    }
+    else
+    {
+      const std::string clang_path = config_.clang_path;
+      return
+        [clang_path](
+          const std::vector<std::string>& args_,
+          const std::string& header_,
+          const std::string& pch_
+        )
+        {
+          precompile(clang_path, args_, header_, pch_);
+        };
+    }
+  }
+
+  std::string compiler_of(const config& config_)
+  {
+    return
+      config_.precompile_in_process ?
+        std::string(cxstring(clang_getClangVersion())) :
+        config_.clang_path;
+  }
+
+  // Returns the header containing content_. The precompiled header is the
+  // header's path followed by ".pch". When there is no cache, the header is
+  // fn_.
+  std::string precompile_content(
+    pch_cache* cache_,
+    const pch_cache::precompiler& precompile_,
+    const std::string& compiler_,
+    const std::vector<std::string>& clang_args_,
+    const std::string& content_,
+    const std::string& fn_
+  )
+  {
+    if (cache_)
+    {
+      return
+        cache_->precompiled_header(
+          compiler_,
+          clang_args_,
+          content_,
+          precompile_
+        );
+    }
+    else
+    {
+      write_file(fn_, content_);
+      precompile_(clang_args_, fn_, fn_ + ".pch");
+      return fn_;
+    }
+  }
+
+  pch_cache* create_pch_cache(const config& config_)
+  {
+    return
+      config_.use_precompiled_headers && !config_.pch_cache_dir.empty() ?
+        new pch_cache(config_.pch_cache_dir, config_.pch_cache_size_mb) :
+        nullptr;
+  }
 }
 
 header_file_environment::header_file_environment(const config& config_) :
+  _config(config_),
   _dir(),
-  _buffer(_dir.path(), config_, "-I" + _dir.path()),
+  _pch_cache(create_pch_cache(config_)),
+  _internal_dir(_pch_cache ? _pch_cache->headers_directory() : _dir.path()),
+  _buffer(_internal_dir, config_, "-I" + _internal_dir),
   _clang_args(),
   _empty_headers(_buffer.internal_dir(), true),
   _use_precompiled_headers(config_.use_precompiled_headers),
-  _clang_path(config_.clang_path)
+  _precompile(create_precompiler(config_)),
+  _compiler(compiler_of(config_)),
+  _pch_chain(),
+  _next_layer(0),
+  _pch_arg_index(0),
+  _tail(),
+  _precompiling(),
+  _precompiling_length(0),
+  _precompiling_everything(false)
 {
   _clang_args = _buffer.clang_arguments();
-  if (_use_precompiled_headers)
+  extend_to_find_headers_in_local_dir(_clang_args);
+
+  if (!_use_precompiled_headers)
   {
-    _clang_args.push_back("-include");
-    _clang_args.push_back(env_filename());
+    save();
   }
+  // There is nothing to precompile in an empty environment. The
+  // -include-pch argument is added by the first precompiled header.
 
-  extend_to_find_headers_in_local_dir(_clang_args);
+  if (!_pch_cache)
+  {
+    // The cache generates them when they are missing. Regenerating them
+    // would invalidate the cached precompiled headers including them.
+    _buffer.get_headers().generate();
+  }
+}
 
-  save();
-  _buffer.get_headers().generate();
+header_file_environment::header_file_environment(
+  const header_file_environment& parent_
+) :
+  environment(),
+  _config(parent_._config),
+  _dir(),
+  _pch_cache(
+    parent_._pch_cache ? new pch_cache(*parent_._pch_cache) : nullptr
+  ),
+  _internal_dir(parent_._internal_dir),
+  _buffer(parent_._buffer),
+  _clang_args(parent_._clang_args),
+  _empty_headers(parent_._empty_headers),
+  _use_precompiled_headers(parent_._use_precompiled_headers),
+  _precompile(parent_._precompile),
+  _compiler(parent_._compiler),
+  _pch_chain(parent_._pch_chain),
+  _next_layer(0),
+  _pch_arg_index(parent_._pch_arg_index),
+  _tail(parent_._tail),
+  _precompiling(),
+  _precompiling_length(0),
+  _precompiling_everything(false)
+{
+  assert(_use_precompiled_headers);
 }
 
 void header_file_environment::append(const std::string& s_)
 {
+  const bool starting_with_default_environment =
+    _use_precompiled_headers
+    && s_ == default_environment()
+    && _buffer.get_all().empty();
+
   _buffer.append(s_);
-  save();
+  if (starting_with_default_environment && use_default_pch())
+  {
+    // Nothing to precompile
+  }
+  else if (_use_precompiled_headers)
+  {
+    _tail += s_ + "\n";
+    use_finished_precompiled_header();
+    if (!_precompiling.valid())
+    {
+      start_precompiling();
+    }
+  }
+  else
+  {
+    save();
+  }
 }
 
 std::string header_file_environment::get() const
 {
-  return
-    _use_precompiled_headers ?
-      std::string() : // The -include directive includes the header
-      "#include <" + std::string(env_fn) + ">\n";
+  if (_use_precompiled_headers)
+  {
+    // The -include-pch argument includes the precompiled part
+    return _tail;
+  }
+  else
+  {
+    return include_env;
+  }
 }
 
 std::string header_file_environment::get_appended(const std::string& s_) const
@@ -109,6 +359,22 @@ std::string header_file_environment::get_appended(const std::string& s_) const
   return get() + s_;
 }
 
+std::vector<boost::string_ref> header_file_environment::get_parts() const
+{
+  return
+    std::vector<boost::string_ref>(
+      1,
+      _use_precompiled_headers ? _tail : include_env
+    );
+}
+
+std::string header_file_environment::get_digest() const
+{
+  digest d;
+  d.append(get());
+  return d.value();
+}
+
 std::vector<std::string>& header_file_environment::clang_arguments()
 {
   return _clang_args;
@@ -122,33 +388,175 @@ const std::vector<std::string>&
 
 std::string header_file_environment::env_filename() const
 {
-  return internal_dir() + "/" + env_fn;
+  return _dir.path() + "/" + env_fn;
 }
 
 void header_file_environment::save()
 {
-  const std::string fn = env_filename();
+  write_file(env_filename(), _buffer.get());
+}
+
+std::vector<std::string>::size_type header_file_environment::use_pch(
+  std::vector<std::string>& args_,
+  const std::string& pch_
+) const
+{
+  if (_pch_arg_index == 0)
   {
-    std::ofstream f(fn.c_str());
-    if (f)
-    {
-      f << _buffer.get();
-    }
-    else
+    const std::vector<std::string>::size_type
+      index = _buffer.clang_arguments().size();
+    const std::string include_pch[] = { "-include-pch", pch_ };
+    args_.insert(args_.begin() + index, include_pch, include_pch + 2);
+    return index + 1;
+  }
+  else
+  {
+    args_[_pch_arg_index] = pch_;
+    return _pch_arg_index;
+  }
+}
+
+void header_file_environment::start_precompiling()
+{
+  std::ostringstream fn;
+  fn << _dir.path() << "/metashell_environment_" << _next_layer << ".hpp";
+  ++_next_layer;
+
+  std::vector<std::string> args(_buffer.clang_arguments());
+
+  _precompiling_length = _tail.size();
+  _precompiling_everything =
+    _pch_chain.empty() || _pch_chain.size() >= max_pch_chain_length;
+  if (!_precompiling_everything)
+  {
+    args.push_back("-include-pch");
+    args.push_back(_clang_args[_pch_arg_index]);
+  }
+
+  pch_cache* const cache = _pch_cache.get();
+  const pch_cache::precompiler precompile = _precompile;
+  const std::string compiler = _compiler;
+  const std::string content = _precompiling_everything ? _buffer.get() : _tail;
+  const std::string header = fn.str();
+  _precompiling =
+    std::async(
+      std::launch::async,
+      [cache, precompile, compiler, args, content, header] ()
+      {
+        return
+          precompile_content(
+            cache,
+            precompile,
+            compiler,
+            args,
+            content,
+            header
+          );
+      }
+    );
+}
+
+bool header_file_environment::use_default_pch()
+{
+  const std::string pch = default_pch(_config);
+  if (pch.empty())
+  {
+    return false;
+  }
+
+  std::vector<std::string> args(_clang_args);
+  const std::vector<std::string>::size_type pch_arg_index = use_pch(args, pch);
+
+  // Clang rejects the precompiled header when it is not compatible with
+  // the clang arguments (eg. a different template depth)
+  try
+  {
+    const environment_snapshot
+      env(std::make_shared<std::string>(), "", args, _empty_headers, "");
+    cxindex index;
+    if (index.parse_code(unsaved_file("<stdin>", ""), env)->has_errors())
     {
-      throw exception("Error saving environment to " + fn);
+      return false;
     }
   }
+  catch (const exception&)
+  {
+    return false;
+  }
 
-  if (_use_precompiled_headers)
+  _clang_args.swap(args);
+  _pch_arg_index = pch_arg_index;
+  // Not in the directory of this environment, so it is never deleted
+  _pch_chain.push_back(pch.substr(0, pch.size() - 4));
+  return true;
+}
+
+void header_file_environment::finish_precompiling()
+{
+  while (_precompiling.valid())
   {
-    precompile(_clang_path, _buffer.clang_arguments(), fn);
+    _precompiling.wait();
+    use_finished_precompiled_header();
+  }
+}
+
+void header_file_environment::use_finished_precompiled_header()
+{
+  if (
+    _precompiling.valid()
+    && _precompiling.wait_for(std::chrono::seconds(0))
+      == std::future_status::ready
+  )
+  {
+    std::string header;
+    try
+    {
+      header = _precompiling.get();
+    }
+    catch (const std::exception&)
+    {
+      // The code remains in the tail and gets precompiled with the code
+      // appended after it. The precompiling thread can fail with errors
+      // coming from the standard library (eg. std::bad_alloc) as well.
+      return;
+    }
+
+    if (_precompiling_everything)
+    {
+      if (!_pch_cache)
+      {
+        const std::string& dir = _dir.path();
+        for (const std::string& h : _pch_chain)
+        {
+          // The chain may start with the headers of the parent environment
+          if (h.compare(0, dir.size(), dir) == 0)
+          {
+            std::remove(h.c_str());
+            std::remove((h + ".pch").c_str());
+          }
+        }
+      }
+      _pch_chain.clear();
+    }
+    _pch_chain.push_back(header);
+    _pch_arg_index = use_pch(_clang_args, header + ".pch");
+    _tail.erase(0, _precompiling_length);
+
+    if (!_tail.empty())
+    {
+      start_precompiling();
+    }
   }
 }
 
+void header_file_environment::refresh()
+{
+  use_finished_precompiled_header();
+}
+
 std::string header_file_environment::internal_dir() const
 {
-  return _dir.path();
+  return _internal_dir;
 }
 
 const headers& header_file_environment::get_headers() const
@@ -161,3 +569,25 @@ std::string header_file_environment::get_all() const
   return _buffer.get_all();
 }
 
+std::string header_file_environment::get_all_digest() const
+{
+  return _buffer.get_all_digest();
+}
+
+std::unique_ptr<environment> header_file_environment::create_child() const
+{
+  if (_use_precompiled_headers)
+  {
+    return
+      std::unique_ptr<environment>(new header_file_environment(*this));
+  }
+  else
+  {
+    // There is nothing compiled to share. The header is saved in the
+    // directory of the new environment.
+    std::unique_ptr<environment> e(new header_file_environment(_config));
+    e->append(get_all());
+    return e;
+  }
+}
+
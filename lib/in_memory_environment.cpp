@@ -58,7 +58,10 @@ in_memory_environment::in_memory_environment(
   const config& config_,
   const std::string& clang_extra_arg_
 ) :
-  _buffer(),
+  _inherited(),
+  _code(std::make_shared<std::string>()),
+  _size(0),
+  _digest(),
   _headers(internal_dir_),
   _clang_args()
 {
@@ -90,19 +93,91 @@ in_memory_environment::in_memory_environment(
   }
 }
 
+in_memory_environment::in_memory_environment(
+  const in_memory_environment& e_
+) :
+  environment(),
+  _inherited(e_._inherited),
+  _code(std::make_shared<std::string>()),
+  _size(e_._size),
+  _digest(e_._digest),
+  _headers(e_._headers),
+  _clang_args(e_._clang_args)
+{
+  if (!e_._code->empty())
+  {
+    _inherited.push_back(e_._code);
+  }
+}
+
 void in_memory_environment::append(const std::string& s_)
 {
-  _buffer = get_appended(s_);
+  if (!_code.unique())
+  {
+    _code = std::make_shared<std::string>(*_code);
+  }
+
+  if (_size > 0)
+  {
+    *_code += '\n';
+    _digest.append('\n');
+  }
+  *_code += s_;
+  _digest.append(s_);
+  _size += (_size > 0 ? 1 : 0) + s_.size();
 }
 
 std::string in_memory_environment::get() const
 {
-  return _buffer;
+  std::string result;
+  result.reserve(_size);
+  for (const std::shared_ptr<const std::string>& part : _inherited)
+  {
+    result += *part;
+  }
+  result += *_code;
+  return result;
 }
 
 std::string in_memory_environment::get_appended(const std::string& s_) const
 {
-  return _buffer.empty() ? s_ : (_buffer + '\n' + s_);
+  if (_size == 0)
+  {
+    return s_;
+  }
+  else
+  {
+    std::string result;
+    result.reserve(_size + 1 + s_.size());
+    for (const std::shared_ptr<const std::string>& part : _inherited)
+    {
+      result += *part;
+    }
+    result += *_code;
+    result += '\n';
+    result += s_;
+    return result;
+  }
+}
+
+std::vector<boost::string_ref> in_memory_environment::get_parts() const
+{
+  std::vector<boost::string_ref> result;
+  result.reserve(_inherited.size() + 1);
+  for (const std::shared_ptr<const std::string>& part : _inherited)
+  {
+    result.push_back(*part);
+  }
+  if (!_code->empty())
+  {
+    result.push_back(*_code);
+  }
+  return result;
+}
+
+std::string in_memory_environment::get_digest() const
+{
+  return _digest.value();
 }
 
 std::vector<std::string>& in_memory_environment::clang_arguments()
@@ -133,6 +208,20 @@ void in_memory_environment::add_clang_arg(const std::string& arg_)
 
 std::string in_memory_environment::get_all() const
 {
-  return _buffer;
+  return get();
 }
 
+std::string in_memory_environment::get_all_digest() const
+{
+  return _digest.value();
+}
+
+std::unique_ptr<environment> in_memory_environment::create_child() const
+{
+  return std::unique_ptr<environment>(new in_memory_environment(*this));
+}
+
+void in_memory_environment::refresh()
+{
+  // Nothing is done in the background
+}
@@ -0,0 +1,199 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/json_shell.hpp>
+#include <metashell/result.hpp>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <cstdio>
+#include <set>
+#include <sstream>
+
+using namespace metashell;
+
+namespace
+{
+  std::string json_string(const std::string& s_)
+  {
+    std::string result("\"");
+    for (char c : s_)
+    {
+      switch (c)
+      {
+      case '"': result += "\\\""; break;
+      case '\\': result += "\\\\"; break;
+      case '\n': result += "\\n"; break;
+      case '\r': result += "\\r"; break;
+      case '\t': result += "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20)
+        {
+          char buff[7];
+          std::snprintf(buff, sizeof(buff), "\\u%04x", int(c));
+          result += buff;
+        }
+        else
+        {
+          result += c;
+        }
+      }
+    }
+    return result + "\"";
+  }
+
+  template <class Cont>
+  std::string json_array(const Cont& items_)
+  {
+    std::string result("[");
+    bool first = true;
+    for (const std::string& s : items_)
+    {
+      if (first)
+      {
+        first = false;
+      }
+      else
+      {
+        result += ",";
+      }
+      result += json_string(s);
+    }
+    return result + "]";
+  }
+
+  std::string json_field(const std::string& name_, const std::string& value_)
+  {
+    return "," + json_string(name_) + ":" + value_;
+  }
+}
+
+json_shell::json_shell(const config& config_) :
+  shell(config_)
+{}
+
+json_shell::json_shell(const config& config_, environment* env_) :
+  shell(config_, env_)
+{}
+
+void json_shell::add_history(const std::string&)
+{
+  // no-op
+}
+
+void json_shell::display_normal(const std::string& s_) const
+{
+  if (!s_.empty())
+  {
+    _output.push_back(s_);
+  }
+}
+
+void json_shell::display_info(const std::string& s_) const
+{
+  if (!s_.empty())
+  {
+    _info.push_back(s_);
+  }
+}
+
+void json_shell::display_error(const std::string& s_) const
+{
+  if (!s_.empty())
+  {
+    _errors.push_back(s_);
+  }
+}
+
+unsigned int json_shell::width() const
+{
+  return 80;
+}
+
+std::string json_shell::process_request(const std::string& request_)
+{
+  _output.clear();
+  _info.clear();
+  _errors.clear();
+
+  std::string id;
+  std::string extra;
+  try
+  {
+    boost::property_tree::ptree req;
+    std::istringstream s(request_);
+    boost::property_tree::read_json(s, req);
+
+    id = req.get<std::string>("id", "");
+    const std::string type = req.get<std::string>("type", "");
+    const std::string code = req.get<std::string>("code", "");
+
+    if (type == "evaluate")
+    {
+      run_metaprogram(code);
+    }
+    else if (type == "validate")
+    {
+      const result r = validate(code);
+      extra = json_field("valid", r.has_errors() ? "false" : "true");
+      _errors.insert(_errors.end(), r.errors.begin(), r.errors.end());
+    }
+    else if (type == "complete")
+    {
+      std::set<std::string> c;
+      code_complete(code, c);
+      extra = json_field("completions", json_array(c));
+    }
+    else if (type == "environment_add")
+    {
+      store_in_buffer(code);
+    }
+    else if (type == "environment_push")
+    {
+      push_environment();
+    }
+    else if (type == "environment_pop")
+    {
+      pop_environment();
+    }
+    else if (type == "shutdown")
+    {
+      stop();
+    }
+    else
+    {
+      display_error("Unknown request type: " + type);
+    }
+  }
+  catch (const std::exception& e)
+  {
+    display_error(std::string("Error: ") + e.what());
+  }
+  catch (...)
+  {
+    display_error("Unknown error");
+  }
+
+  return
+    "{" + json_string("id") + ":" + json_string(id)
+      + json_field("output", json_array(_output))
+      + json_field("info", json_array(_info))
+      + json_field("errors", json_array(_errors))
+      + extra
+    + "}";
+}
+
@@ -20,8 +20,12 @@
 #include <metashell/metashell.hpp>
 #include <metashell/temporary_file.hpp>
 #include <metashell/is_template_type.hpp>
+#include <metashell/metaprogram_export.hpp>
 
 #include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
 
 #include <boost/assign.hpp>
 #include <boost/optional.hpp>
@@ -71,6 +75,25 @@ const mdb_command_handler_map mdb_shell::command_handler =
         "",
         "Print backtrace from the current point.",
         ""},
+      {{"profile"}, non_repeatable, &mdb_shell::command_profile,
+        "[templates] [self|total|count|memory] [n]",
+        "Print the most expensive instantiations.",
+        "Lists the n (10 by default) instantiated types with the highest cost.\n"
+        "With the templates qualifier the instances of the same template are\n"
+        "summed up. The list is ordered by the time spent in the instantiation\n"
+        "itself (self, the default), the time including the nested instantiations\n"
+        "(total), the number of instantiations (count) or the memory allocated by\n"
+        "the instantiation itself (memory). The times are in milliseconds. The\n"
+        "memory usage is displayed when Metashell runs with --templight_memory.\n\n"
+        "Memoizations are not counted. The total time of a recursive template\n"
+        "contains the time of the nested instances only once."},
+      {{"export"}, non_repeatable, &mdb_shell::command_export,
+        "flamegraph|chrome <file>",
+        "Export the instantiation times of the metaprogram.",
+        "flamegraph writes the folded stacks format of flamegraph.pl and\n"
+        "speedscope, the values are the times spent in the instantiations in\n"
+        "microseconds. chrome writes the trace event format of chrome://tracing\n"
+        "and Perfetto."},
       {{"help"}, non_repeatable, &mdb_shell::command_help,
         "[command]",
         "Show help for commands.",
@@ -368,11 +391,14 @@ void mdb_shell::command_evaluate(const std::string& arg_ref) {
         mp->get_vertex_property(mp->get_target(edge)).name;
 
       if (mp->get_source(edge) == mp->get_root_vertex()) {
+        const file_location point_of_instantiation =
+          mp->get_point_of_instantiation(edge);
+
         // Filter out edges, that is not instantiated by the entered type
-        if (edge_property.point_of_instantiation.name != internal_file_name) {
+        if (point_of_instantiation.name != internal_file_name) {
           return true;
         }
-        if (edge_property.point_of_instantiation.row != line_number + 2) {
+        if (point_of_instantiation.row != line_number + 2) {
           return true;
         }
         // Filter out one of the events triggered by
@@ -455,6 +481,96 @@ void mdb_shell::command_backtrace(const std::string& arg) {
   display_backtrace();
 }
 
+void mdb_shell::command_profile(const std::string& arg) {
+  if (!require_evaluated_metaprogram()) {
+    return;
+  }
+
+  using boost::spirit::qi::lit;
+  using boost::spirit::qi::uint_;
+  using boost::spirit::ascii::space;
+  using boost::spirit::qi::_1;
+
+  namespace phx = boost::phoenix;
+
+  auto begin = arg.begin(),
+       end = arg.end();
+
+  bool by_template = false;
+  profile_order order = profile_order::self_time;
+  unsigned max_count = 10;
+
+  bool result =
+    boost::spirit::qi::phrase_parse(
+        begin, end,
+
+        -lit("templates") [phx::ref(by_template) = true] >>
+        -(
+          lit("self") [phx::ref(order) = profile_order::self_time] |
+          lit("total") [phx::ref(order) = profile_order::total_time] |
+          lit("count") [phx::ref(order) = profile_order::count] |
+          lit("memory") [phx::ref(order) = profile_order::memory]
+        ) >>
+        -uint_ [phx::ref(max_count) = _1],
+
+        space
+    );
+
+  if (!result || begin != end) {
+    display_argument_parsing_failed();
+    return;
+  }
+
+  if (order == profile_order::memory && !conf.templight_memory) {
+    display_error(
+        "Memory usage is not recorded, start Metashell with"
+        " --templight_memory\n");
+    return;
+  }
+
+  display_profile(
+      by_template ?
+        profile_templates(*mp, order) :
+        profile_instantiations(*mp, order),
+      max_count);
+}
+
+void mdb_shell::command_export(const std::string& arg) {
+  if (!require_evaluated_metaprogram()) {
+    return;
+  }
+
+  using boost::trim_copy;
+
+  const std::string::size_type space = arg.find(' ');
+  const std::string format = arg.substr(0, space);
+  const std::string file =
+    space == std::string::npos ? "" : trim_copy(arg.substr(space));
+
+  if (file.empty() || (format != "flamegraph" && format != "chrome")) {
+    display_argument_parsing_failed();
+    return;
+  }
+
+  std::ofstream out(file, std::ios::out | std::ios::binary);
+  if (!out) {
+    display_error("Can't open file " + file + "\n");
+    return;
+  }
+
+  if (format == "flamegraph") {
+    write_folded_stacks(*mp, out);
+  } else {
+    write_chrome_trace(*mp, out);
+  }
+
+  if (!out) {
+    display_error("Failed to write file " + file + "\n");
+    return;
+  }
+  display_info("Exported to " + file + "\n");
+}
+
 void mdb_shell::command_rbreak(const std::string& arg) {
   try {
     breakpoints.push_back(boost::regex(arg));
@@ -513,10 +629,12 @@ void mdb_shell::command_quit(const std::string& arg) {
 bool mdb_shell::run_metaprogram_with_templight(
     const std::string& str)
 {
-  temporary_file templight_xml_file("templight-%%%%-%%%%-%%%%-%%%%.xml");
-  std::string xml_path = templight_xml_file.get_path().string();
+  temporary_file templight_trace_file(
+      "templight-%%%%-%%%%-%%%%-%%%%." +
+      templight_argument(conf.templight_trace_format));
+  std::string trace_path = templight_trace_file.get_path().string();
 
-  env.set_xml_location(xml_path);
+  env.set_trace_location(trace_path);
 
   boost::optional<std::string> evaluation_result = run_metaprogram(str);
 
@@ -525,7 +643,8 @@ bool mdb_shell::run_metaprogram_with_templight(
     return false;
   }
 
-  mp = metaprogram::create_from_xml_file(xml_path, str, *evaluation_result);
+  mp = metaprogram::create_from_file(
+      trace_path, conf.templight_trace_format, str, *evaluation_result);
   return true;
 }
 
@@ -684,8 +803,6 @@ void mdb_shell::display_trace_visit(
   // doesn't have any more children.
   // The 0th element is never read.
 
-  const metaprogram::graph_t& graph = mp->get_graph();
-
   std::vector<unsigned> depth_counter(1);
 
   typedef std::tuple<
@@ -728,12 +845,6 @@ void mdb_shell::display_trace_visit(
       continue;
     }
 
-    metaprogram::out_edge_iterator begin, end;
-    std::tie(begin, end) = boost::out_edges(vertex, graph);
-
-    typedef std::vector<metaprogram::edge_descriptor> edges_t;
-    edges_t edges(begin, end);
-
     if (depth_counter.size() <= depth+1) {
       depth_counter.resize(depth+1+1);
     }
@@ -741,7 +852,7 @@ void mdb_shell::display_trace_visit(
     // Reverse iteration, so types that got instantiated first
     // get on the top of the stack
     for (const metaprogram::edge_descriptor& edge :
-        edges | boost::adaptors::reversed)
+        mp->get_out_edges(vertex) | boost::adaptors::reversed)
     {
       if (mp->get_edge_property(edge).enabled) {
         to_visit.push(std::make_tuple(edge, depth+1));
@@ -790,6 +901,39 @@ void mdb_shell::display_backtrace() const {
         mp->get_vertex_property(mp->get_root_vertex()).name) + "\n");
 }
 
+void mdb_shell::display_profile(
+    const std::vector<profile_entry>& profile,
+    unsigned max_count) const
+{
+  std::ostringstream s;
+  s << std::fixed << std::setprecision(3)
+    << std::setw(8) << "Count"
+    << std::setw(12) << "Self (ms)"
+    << std::setw(12) << "Total (ms)";
+  if (conf.templight_memory) {
+    s << std::setw(14) << "Self memory"
+      << std::setw(14) << "Total memory";
+  }
+  s << "  Name\n";
+  display(colored_string(s.str(), color::white));
+
+  for (unsigned i = 0; i < profile.size() && i < max_count; ++i) {
+    const profile_entry& entry = profile[i];
+
+    s.str("");
+    s << std::setw(8) << entry.count
+      << std::setw(12) << entry.self_time * 1000
+      << std::setw(12) << entry.total_time * 1000;
+    if (conf.templight_memory) {
+      s << std::setw(14) << entry.self_memory_usage
+        << std::setw(14) << entry.memory_usage;
+    }
+    s << "  ";
+    display(s.str());
+    display(highlight_syntax(entry.name) + "\n");
+  }
+}
+
 void mdb_shell::display_argument_parsing_failed() const {
   display_error("Argument parsing failed\n");
 }
@@ -16,9 +16,12 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <metashell/metaprogram.hpp>
+#include <metashell/exception.hpp>
 
 #include <tuple>
 #include <cassert>
+#include <limits>
+#include <numeric>
 #include <algorithm>
 
 #include <boost/foreach.hpp>
@@ -26,6 +29,34 @@
 
 namespace metashell {
 
+namespace {
+
+// Counting sort of the edges by their source (or target) vertex. It is
+// stable, so the edges of a vertex remain in the order they were added.
+template <class Adjacency, class Vertex>
+void build_adjacency(
+    Adjacency& adjacency,
+    std::size_t vertex_count,
+    const std::vector<Vertex>& edge_vertices)
+{
+  adjacency.offsets.assign(vertex_count + 1, 0);
+  for (Vertex vertex : edge_vertices) {
+    ++adjacency.offsets[vertex + 1];
+  }
+  std::partial_sum(
+    adjacency.offsets.begin(),
+    adjacency.offsets.end(),
+    adjacency.offsets.begin());
+
+  adjacency.edges.resize(edge_vertices.size());
+  auto next = adjacency.offsets;
+  for (std::size_t edge = 0; edge < edge_vertices.size(); ++edge) {
+    adjacency.edges[next[edge_vertices[edge]]++] = edge;
+  }
+}
+
+}
+
 metaprogram::metaprogram(
     const std::string& root_name,
     const std::string& evaluation_result) :
@@ -35,10 +66,31 @@ metaprogram::metaprogram(
   reset_state();
 }
 
+metaprogram metaprogram::create_from_file(
+    const std::string& file,
+    templight_format::type format,
+    const std::string& root_name,
+    const std::string& evaluation_result)
+{
+  switch (format) {
+  case templight_format::xml:
+    return create_from_xml_file(file, root_name, evaluation_result);
+  case templight_format::binary:
+    return create_from_binary_file(file, root_name, evaluation_result);
+  }
+  throw exception("Invalid templight format");
+}
+
 metaprogram::vertex_descriptor metaprogram::add_vertex(
   const std::string& element)
 {
-  vertex_descriptor vertex = boost::add_vertex(graph);
+  if (vertices.size() >= std::numeric_limits<vertex_descriptor>::max()) {
+    throw exception("Too many types in the metaprogram");
+  }
+
+  vertex_descriptor vertex = vertices.size();
+  vertices.push_back(vertex_property{element});
+  adjacency_up_to_date = false;
 
   assert(state.discovered.size() == vertex);
   assert(state.parent_edge.size() == vertex);
@@ -46,8 +98,6 @@ metaprogram::vertex_descriptor metaprogram::add_vertex(
   state.discovered.push_back(false);
   state.parent_edge.push_back(boost::none);
 
-  get_vertex_property(vertex).name = element;
-
   return vertex;
 }
 
@@ -57,14 +107,26 @@ metaprogram::edge_descriptor metaprogram::add_edge(
     instantiation_kind kind,
     const file_location& point_of_instantiation)
 {
-  edge_descriptor edge;
-  bool inserted;
-  std::tie(edge, inserted) = boost::add_edge(from, to, graph);
+  assert(from < vertices.size());
+  assert(to < vertices.size());
+
+  if (edge_properties.size() >= std::numeric_limits<edge_descriptor>::max()) {
+    throw exception("Too many instantiations in the metaprogram");
+  }
 
-  assert(inserted);
+  edge_descriptor edge = edge_properties.size();
 
-  get_edge_property(edge).kind = kind;
-  get_edge_property(edge).point_of_instantiation = point_of_instantiation;
+  edge_property property;
+  property.kind = kind;
+  property.point_of_instantiation.file =
+    file_names.intern(point_of_instantiation.name);
+  property.point_of_instantiation.row = point_of_instantiation.row;
+  property.point_of_instantiation.column = point_of_instantiation.column;
+
+  edge_sources.push_back(from);
+  edge_targets.push_back(to);
+  edge_properties.push_back(property);
+  adjacency_up_to_date = false;
 
   return edge;
 }
@@ -152,76 +214,122 @@ void metaprogram::step_back() {
   state_history.pop();
 }
 
-const metaprogram::graph_t& metaprogram::get_graph() const {
-  return graph;
-}
-
 const metaprogram::state_t& metaprogram::get_state() const {
   return state;
 }
 
 metaprogram::vertices_size_type metaprogram::get_num_vertices() const {
-  return boost::num_vertices(graph);
+  return vertices.size();
 }
 
 metaprogram::edges_size_type metaprogram::get_num_edges() const {
-  return boost::num_edges(graph);
+  return edge_properties.size();
 }
 
 metaprogram::vertex_descriptor metaprogram::get_source(
     const edge_descriptor& edge) const
 {
-  return boost::source(edge, graph);
+  return edge_sources[edge];
 }
 
 metaprogram::vertex_descriptor metaprogram::get_target(
     const edge_descriptor& edge) const
 {
-  return boost::target(edge, graph);
+  return edge_targets[edge];
+}
+
+metaprogram::optional_edge_descriptor metaprogram::find_edge(
+    vertex_descriptor from,
+    vertex_descriptor to) const
+{
+  for (edge_descriptor edge : get_out_edges(from)) {
+    if (get_target(edge) == to) {
+      return edge;
+    }
+  }
+  return boost::none;
 }
 
 boost::iterator_range<metaprogram::in_edge_iterator>
 metaprogram::get_in_edges(vertex_descriptor vertex) const {
-  return boost::in_edges(vertex, graph);
+  update_adjacency();
+  return
+    boost::make_iterator_range(
+      in_adjacency.edges.begin() + in_adjacency.offsets[vertex],
+      in_adjacency.edges.begin() + in_adjacency.offsets[vertex + 1]);
 }
 
 boost::iterator_range<metaprogram::out_edge_iterator>
 metaprogram::get_out_edges(vertex_descriptor vertex) const {
-  return boost::out_edges(vertex, graph);
+  update_adjacency();
+  return
+    boost::make_iterator_range(
+      out_adjacency.edges.begin() + out_adjacency.offsets[vertex],
+      out_adjacency.edges.begin() + out_adjacency.offsets[vertex + 1]);
 }
 
 boost::iterator_range<metaprogram::vertex_iterator>
 metaprogram::get_vertices() const {
-  return boost::vertices(graph);
+  return
+    boost::make_iterator_range(
+      vertex_iterator(0),
+      vertex_iterator(get_num_vertices()));
 }
 
 boost::iterator_range<metaprogram::edge_iterator>
 metaprogram::get_edges() const {
-  return boost::edges(graph);
+  return
+    boost::make_iterator_range(
+      edge_iterator(0),
+      edge_iterator(get_num_edges()));
 }
 
 const metaprogram::vertex_property& metaprogram::get_vertex_property(
     vertex_descriptor vertex) const
 {
-  return boost::get(vertex_property_tag(), graph, vertex);
+  return vertices[vertex];
 }
 
 const metaprogram::edge_property& metaprogram::get_edge_property(
     edge_descriptor edge) const
 {
-  return boost::get(edge_property_tag(), graph, edge);
+  return edge_properties[edge];
 }
 
 metaprogram::vertex_property& metaprogram::get_vertex_property(
     vertex_descriptor vertex)
 {
-  return boost::get(vertex_property_tag(), graph, vertex);
+  return vertices[vertex];
 }
 
 metaprogram::edge_property& metaprogram::get_edge_property(
     edge_descriptor edge)
 {
-  return boost::get(edge_property_tag(), graph, edge);
+  return edge_properties[edge];
+}
+
+file_location metaprogram::get_point_of_instantiation(
+    edge_descriptor edge) const
+{
+  const pooled_file_location& location =
+    get_edge_property(edge).point_of_instantiation;
+  return
+    file_location(
+      file_names[location.file],
+      location.row,
+      location.column);
+}
+
+const string_pool& metaprogram::get_file_names() const {
+  return file_names;
+}
+
+void metaprogram::update_adjacency() const {
+  if (!adjacency_up_to_date) {
+    build_adjacency(out_adjacency, vertices.size(), edge_sources);
+    build_adjacency(in_adjacency, vertices.size(), edge_targets);
+    adjacency_up_to_date = true;
+  }
 }
 
 metaprogram::vertex_descriptor metaprogram::get_current_vertex() const {
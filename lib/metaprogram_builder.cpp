@@ -0,0 +1,110 @@
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "metaprogram_builder.hpp"
+
+#include <metashell/exception.hpp>
+
+#include <utility>
+
+namespace metashell {
+
+metaprogram_builder::metaprogram_builder(
+    const std::string& root_name,
+    const std::string& evaluation_result) :
+  mp(root_name, evaluation_result)
+{}
+
+void metaprogram_builder::handle_template_begin(
+  instantiation_kind kind,
+  const std::string& context,
+  const file_location& point_of_instantiation,
+  double timestamp,
+  unsigned long long memory_usage)
+{
+  vertex_descriptor vertex = add_vertex(context);
+  vertex_descriptor top_vertex =
+    instantiation_stack.empty() ?
+      mp.get_root_vertex() :
+      instantiation_stack.top().vertex;
+
+  open_instantiation inst;
+  inst.vertex = vertex;
+  inst.edge = mp.add_edge(top_vertex, vertex, kind, point_of_instantiation);
+  inst.begin_timestamp = timestamp;
+  inst.begin_memory_usage = memory_usage;
+
+  mp.get_edge_property(inst.edge).begin_timestamp = timestamp;
+  instantiation_stack.push(inst);
+}
+
+void metaprogram_builder::handle_template_end(
+  instantiation_kind /* kind */,
+  double timestamp,
+  unsigned long long memory_usage)
+{
+  if (instantiation_stack.empty()) {
+    throw exception(
+        "Mismatched Templight TemplateBegin and TemplateEnd events");
+  }
+  const open_instantiation inst = instantiation_stack.top();
+  instantiation_stack.pop();
+
+  const double time_taken = timestamp - inst.begin_timestamp;
+  const long long memory_delta =
+    static_cast<long long>(memory_usage - inst.begin_memory_usage);
+
+  metaprogram::edge_property& property = mp.get_edge_property(inst.edge);
+  property.time_taken = time_taken;
+  property.self_time = time_taken - inst.nested_time;
+  property.memory_usage = memory_delta;
+  property.self_memory_usage = memory_delta - inst.nested_memory_usage;
+
+  if (!instantiation_stack.empty()) {
+    instantiation_stack.top().nested_time += time_taken;
+    instantiation_stack.top().nested_memory_usage += memory_delta;
+  }
+}
+
+metaprogram metaprogram_builder::release_metaprogram() {
+  if (!instantiation_stack.empty()) {
+    throw exception(
+        "Some Templight TemplateEnd events are missing");
+  }
+  return std::move(mp);
+}
+
+metaprogram_builder::vertex_descriptor metaprogram_builder::add_vertex(
+    const std::string& context)
+{
+  const boost::optional<vertex_descriptor> existing =
+    vertex_index.find(
+      context,
+      [this](vertex_descriptor vertex) -> const std::string& {
+        return mp.get_vertex_property(vertex).name;
+      });
+
+  if (existing) {
+    return *existing;
+  }
+  const vertex_descriptor vertex = mp.add_vertex(context);
+  vertex_index.insert(context, vertex);
+  return vertex;
+}
+
+}
+
@@ -0,0 +1,80 @@
+#ifndef METASHELL_METAPROGRAM_BUILDER_HPP
+#define METASHELL_METAPROGRAM_BUILDER_HPP
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stack>
+#include <string>
+
+#include <metashell/metaprogram.hpp>
+#include <metashell/string_pool.hpp>
+
+namespace metashell {
+
+// Builds a metaprogram from the events of a templight trace
+struct metaprogram_builder {
+
+  metaprogram_builder(
+      const std::string& root_name,
+      const std::string& evaluation_result);
+
+  void handle_template_begin(
+    instantiation_kind kind,
+    const std::string& context,
+    const file_location& location,
+    double timestamp,
+    unsigned long long memory_usage);
+
+  void handle_template_end(
+    instantiation_kind kind,
+    double timestamp,
+    unsigned long long memory_usage);
+
+  // Moves the metaprogram out of the builder, the builder can not be used
+  // after calling it
+  metaprogram release_metaprogram();
+
+private:
+  typedef metaprogram::vertex_descriptor vertex_descriptor;
+  typedef metaprogram::edge_descriptor edge_descriptor;
+
+  // An instantiation which has started but not finished yet
+  struct open_instantiation {
+    vertex_descriptor vertex;
+    edge_descriptor edge;
+    double begin_timestamp;
+    unsigned long long begin_memory_usage;
+    // Collected from the nested instantiations
+    double nested_time = 0.0;
+    long long nested_memory_usage = 0;
+  };
+
+  vertex_descriptor add_vertex(const std::string& context);
+
+  metaprogram mp;
+
+  std::stack<open_instantiation> instantiation_stack;
+
+  // The vertices by their names. The names are stored only in the
+  // metaprogram.
+  string_index vertex_index;
+};
+
+}
+
+#endif
+
@@ -0,0 +1,202 @@
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/metaprogram_export.hpp>
+
+#include <cmath>
+#include <algorithm>
+#include <tuple>
+#include <stack>
+#include <vector>
+#include <limits>
+#include <iomanip>
+
+namespace metashell {
+
+namespace {
+
+// Depth first traversal of the enabled edges in the order they were
+// instantiated. on_begin is called when an edge is entered, on_end when it
+// is left, both with the depth of the edge (1 for the edges of the root).
+template <class OnBegin, class OnEnd>
+void visit_edges(const metaprogram& mp, OnBegin on_begin, OnEnd on_end) {
+  typedef std::tuple<
+    metaprogram::edge_descriptor,
+    unsigned, // Depth
+    bool // Leaving the edge
+  > stack_element;
+
+  std::stack<stack_element> to_visit;
+  metaprogram::discovered_t discovered(mp.get_num_vertices());
+
+  auto push_out_edges =
+    [&](metaprogram::vertex_descriptor vertex, unsigned depth) {
+      discovered[vertex] = true;
+      auto out_edges = mp.get_out_edges(vertex);
+      // Reverse iteration, so types that got instantiated first
+      // get on the top of the stack
+      for (auto it = out_edges.end(); it != out_edges.begin();) {
+        --it;
+        if (mp.get_edge_property(*it).enabled) {
+          to_visit.push(std::make_tuple(*it, depth, false));
+        }
+      }
+    };
+
+  push_out_edges(mp.get_root_vertex(), 1);
+
+  while (!to_visit.empty()) {
+    metaprogram::edge_descriptor edge;
+    unsigned depth;
+    bool leaving;
+    std::tie(edge, depth, leaving) = to_visit.top();
+    to_visit.pop();
+
+    if (leaving) {
+      on_end(edge, depth);
+    } else {
+      on_begin(edge, depth);
+      to_visit.push(std::make_tuple(edge, depth, true));
+
+      metaprogram::vertex_descriptor target = mp.get_target(edge);
+      if (!discovered[target]) {
+        push_out_edges(target, depth + 1);
+      }
+    }
+  }
+}
+
+// The frames of the folded format are separated by ; and the count by
+// the last space, so ; is replaced in the names
+void write_frame_name(const std::string& name, std::ostream& out) {
+  if (name.find(';') == std::string::npos) {
+    out.write(name.data(), name.size());
+  } else {
+    for (char c : name) {
+      out.put(c == ';' ? ':' : c);
+    }
+  }
+}
+
+void write_json_string(const std::string& str, std::ostream& out) {
+  out.put('"');
+  for (char c : str) {
+    switch (c) {
+    case '"': out << "\\\""; break;
+    case '\\': out << "\\\\"; break;
+    case '\n': out << "\\n"; break;
+    case '\t': out << "\\t"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+          << int(c) << std::dec << std::setfill(' ');
+      } else {
+        out.put(c);
+      }
+    }
+  }
+  out.put('"');
+}
+
+}
+
+void write_folded_stacks(const metaprogram& mp, std::ostream& out) {
+  // The names on the current path, they are not copied
+  std::vector<const std::string*> path(1,
+      &mp.get_vertex_property(mp.get_root_vertex()).name);
+
+  visit_edges(
+    mp,
+    [&](const metaprogram::edge_descriptor& edge, unsigned depth) {
+      path.resize(depth + 1);
+      path[depth] = &mp.get_vertex_property(mp.get_target(edge)).name;
+
+      const long long microseconds =
+        std::llround(mp.get_edge_property(edge).self_time * 1000000);
+      if (microseconds > 0) {
+        for (unsigned i = 0; i <= depth; ++i) {
+          if (i > 0) {
+            out.put(';');
+          }
+          write_frame_name(*path[i], out);
+        }
+        out << ' ' << microseconds << '\n';
+      }
+    },
+    [](const metaprogram::edge_descriptor&, unsigned) {});
+}
+
+void write_chrome_trace(const metaprogram& mp, std::ostream& out) {
+  // The timestamps are displayed relative to the first instantiation
+  double start = std::numeric_limits<double>::max();
+  for (metaprogram::edge_descriptor edge : mp.get_edges()) {
+    const metaprogram::edge_property& property = mp.get_edge_property(edge);
+    if (property.enabled) {
+      start = std::min(start, property.begin_timestamp);
+    }
+  }
+
+  const auto write_timestamp = [&](double timestamp) {
+    out << ",\"ts\":" << (timestamp - start) * 1000000;
+  };
+
+  bool first = true;
+  const auto separate_event = [&]() {
+    out << (first ? "\n" : ",\n");
+    first = false;
+  };
+
+  const std::ios_base::fmtflags flags = out.flags();
+  const std::streamsize precision = out.precision();
+  out << std::fixed << std::setprecision(3);
+
+  out << "{\"traceEvents\":[";
+  visit_edges(
+    mp,
+    [&](const metaprogram::edge_descriptor& edge, unsigned) {
+      const metaprogram::edge_property& property = mp.get_edge_property(edge);
+
+      separate_event();
+      out << "{\"name\":";
+      write_json_string(
+          mp.get_vertex_property(mp.get_target(edge)).name, out);
+      out << ",\"cat\":\"" << property.kind << "\",\"ph\":\"B\"";
+      write_timestamp(property.begin_timestamp);
+      out << ",\"pid\":1,\"tid\":1,\"args\":{\"point_of_instantiation\":";
+      write_json_string(
+          mp.get_file_names()[property.point_of_instantiation.file], out);
+      out
+        << ",\"row\":" << property.point_of_instantiation.row
+        << ",\"column\":" << property.point_of_instantiation.column
+        << "}}";
+    },
+    [&](const metaprogram::edge_descriptor& edge, unsigned) {
+      const metaprogram::edge_property& property = mp.get_edge_property(edge);
+
+      separate_event();
+      out << "{\"ph\":\"E\"";
+      write_timestamp(property.begin_timestamp + property.time_taken);
+      out << ",\"pid\":1,\"tid\":1}";
+    });
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+  out.flags(flags);
+  out.precision(precision);
+}
+
+}
+
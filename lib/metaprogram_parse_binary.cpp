@@ -0,0 +1,243 @@
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <sstream>
+#include <fstream>
+
+#include <boost/cstdint.hpp>
+
+#include <metashell/metaprogram.hpp>
+
+#include "metaprogram_builder.hpp"
+
+#include <metashell/exception.hpp>
+
+namespace metashell {
+
+// Reads the binary trace format of templight:
+//   header:  "TLBT" <version: u32 = 1>
+//   entry:   <payload length: u32> <payload>
+//   payload: <is template begin: u8> <kind: u8> <timestamp: f64>
+//            <memory usage: u64>
+//            and for template begins: <name: string> <file name: string>
+//            <line: u32> <column: u32>
+//   string:  <id: u32>, when the id is the number of strings read so far
+//            it is followed by <length: u32> <bytes> defining that string
+// Every integer is little endian. The bytes at the end of a payload which
+// are not described above are ignored.
+class binary_trace_reader {
+public:
+  explicit binary_trace_reader(std::istream& stream);
+
+  // Reads the next payload, returns false at the end of the trace
+  bool next_entry();
+
+  boost::uint64_t read_integer(unsigned bytes);
+  double read_double();
+  const std::string& read_string();
+
+private:
+  void read_raw(char* buf, std::size_t size);
+
+  std::streambuf* buffer;
+
+  std::vector<char> payload;
+  std::size_t position = 0;
+
+  // Deque to keep the returned references valid
+  std::deque<std::string> strings;
+};
+
+binary_trace_reader::binary_trace_reader(std::istream& stream) :
+  buffer(stream.rdbuf())
+{
+  char magic[4];
+  if (
+    buffer->sgetn(magic, sizeof(magic)) !=
+      static_cast<std::streamsize>(sizeof(magic))
+    || std::memcmp(magic, "TLBT", sizeof(magic)) != 0)
+  {
+    // Eg. a templight without binary trace support wrote an XML trace
+    throw exception(
+      "templight binary parse failed (the trace does not start with TLBT,"
+      " it is not a binary trace; use --templight_format xml for the"
+      " traces of this templight)");
+  }
+
+  payload.resize(4);
+  read_raw(payload.data(), payload.size());
+  if (read_integer(4) != 1) {
+    throw exception("templight binary parse failed (unsupported version)");
+  }
+}
+
+bool binary_trace_reader::next_entry() {
+  if (buffer->sgetc() == std::char_traits<char>::eof()) {
+    return false;
+  }
+
+  payload.resize(4);
+  position = 0;
+  read_raw(payload.data(), payload.size());
+  const boost::uint64_t length = read_integer(4);
+
+  // The payload grows with the data actually read, therefore a broken
+  // length can not allocate memory beyond the size of the trace
+  const std::size_t chunk_size = 64 * 1024;
+  payload.clear();
+  position = 0;
+  while (payload.size() < length) {
+    const std::size_t read_so_far = payload.size();
+    payload.resize(
+        read_so_far + std::min<boost::uint64_t>(
+          chunk_size, length - read_so_far));
+    read_raw(payload.data() + read_so_far, payload.size() - read_so_far);
+  }
+  return true;
+}
+
+boost::uint64_t binary_trace_reader::read_integer(unsigned bytes) {
+  if (payload.size() - position < bytes) {
+    throw exception("templight binary parse failed (truncated entry)");
+  }
+  boost::uint64_t result = 0;
+  for (unsigned i = 0; i < bytes; ++i) {
+    result |=
+      boost::uint64_t(static_cast<unsigned char>(payload[position + i]))
+        << (8 * i);
+  }
+  position += bytes;
+  return result;
+}
+
+double binary_trace_reader::read_double() {
+  static_assert(sizeof(double) == sizeof(boost::uint64_t),
+      "The timestamps are stored as 64 bit doubles");
+
+  const boost::uint64_t bits = read_integer(8);
+  double result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+const std::string& binary_trace_reader::read_string() {
+  const boost::uint64_t id = read_integer(4);
+  if (id == strings.size()) {
+    const boost::uint64_t length = read_integer(4);
+    if (payload.size() - position < length) {
+      throw exception("templight binary parse failed (truncated entry)");
+    }
+    strings.emplace_back(payload.data() + position, length);
+    position += length;
+  } else if (id > strings.size()) {
+    throw exception("templight binary parse failed (invalid string id)");
+  }
+  return strings[id];
+}
+
+void binary_trace_reader::read_raw(char* buf, std::size_t size) {
+  if (
+    buffer->sgetn(buf, static_cast<std::streamsize>(size)) !=
+    static_cast<std::streamsize>(size))
+  {
+    throw exception("templight binary parse failed (unexpected end of file)");
+  }
+}
+
+instantiation_kind instantiation_kind_from_index(boost::uint64_t index) {
+  // The order of the instantiation kinds in templight
+  const static instantiation_kind kinds[] = {
+    instantiation_kind::template_instantiation,
+    instantiation_kind::default_template_argument_instantiation,
+    instantiation_kind::default_function_argument_instantiation,
+    instantiation_kind::explicit_template_argument_substitution,
+    instantiation_kind::deduced_template_argument_substitution,
+    instantiation_kind::prior_template_argument_substitution,
+    instantiation_kind::default_template_argument_checking,
+    instantiation_kind::exception_spec_instantiation,
+    instantiation_kind::memoization
+  };
+
+  if (index >= sizeof(kinds) / sizeof(kinds[0])) {
+    throw exception(
+        "templight binary parse failed (invalid instantiation kind)");
+  }
+  return kinds[index];
+}
+
+metaprogram metaprogram::create_from_binary_stream(
+    std::istream& stream,
+    const std::string& root_name,
+    const std::string& evaluation_result)
+{
+  metaprogram_builder builder(root_name, evaluation_result);
+
+  binary_trace_reader reader(stream);
+  while (reader.next_entry()) {
+    const bool begin_event = reader.read_integer(1) != 0;
+    const instantiation_kind kind =
+      instantiation_kind_from_index(reader.read_integer(1));
+    const double timestamp = reader.read_double();
+    const unsigned long long memory_usage = reader.read_integer(8);
+
+    if (begin_event) {
+      const std::string& context = reader.read_string();
+      const std::string& file_name = reader.read_string();
+      const int line = reader.read_integer(4);
+      const int column = reader.read_integer(4);
+
+      builder.handle_template_begin(
+          kind,
+          context,
+          file_location(file_name, line, column),
+          timestamp,
+          memory_usage);
+    } else {
+      builder.handle_template_end(kind, timestamp, memory_usage);
+    }
+  }
+  return builder.release_metaprogram();
+}
+
+metaprogram metaprogram::create_from_binary_file(
+    const std::string& file,
+    const std::string& root_name,
+    const std::string& evaluation_result)
+{
+  std::ifstream in(file, std::ios::in | std::ios::binary);
+  if (!in) {
+    throw exception("Can't open templight file");
+  }
+  return create_from_binary_stream(in, root_name, evaluation_result);
+}
+
+metaprogram metaprogram::create_from_binary_string(
+    const std::string& string,
+    const std::string& root_name,
+    const std::string& evaluation_result)
+{
+  std::istringstream ss(string);
+  return create_from_binary_stream(ss, root_name, evaluation_result);
+}
+
+}
+
@@ -17,108 +17,24 @@
 
 #include <map>
 #include <string>
+#include <vector>
+#include <utility>
 #include <sstream>
+#include <fstream>
 
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
-#include <boost/property_tree/xml_parser.hpp>
+#include <boost/optional.hpp>
 
 #include <metashell/metaprogram.hpp>
 
+#include "metaprogram_builder.hpp"
+
 #include <metashell/exception.hpp>
 
 namespace metashell {
 
-struct metaprogram_builder {
-
-  metaprogram_builder(
-      const std::string& root_name,
-      const std::string& evaluation_result);
-
-  void handle_template_begin(
-    instantiation_kind kind,
-    const std::string& context,
-    const file_location& location,
-    double timestamp,
-    unsigned long long memory_usage);
-
-  void handle_template_end(
-    instantiation_kind kind,
-    double timestamp,
-    unsigned long long memory_usage);
-
-  const metaprogram& get_metaprogram() const;
-
-private:
-  typedef metaprogram::vertex_descriptor vertex_descriptor;
-  typedef std::map<std::string, vertex_descriptor> element_vertex_map_t;
-
-  vertex_descriptor add_vertex(const std::string& context);
-
-  metaprogram mp;
-
-  std::stack<vertex_descriptor> vertex_stack;
-
-  element_vertex_map_t element_vertex_map;
-};
-
-metaprogram_builder::metaprogram_builder(
-    const std::string& root_name,
-    const std::string& evaluation_result) :
-  mp(root_name, evaluation_result)
-{}
-
-void metaprogram_builder::handle_template_begin(
-  instantiation_kind kind,
-  const std::string& context,
-  const file_location& point_of_instantiation,
-  double /* timestamp */,
-  unsigned long long /* memory_usage */)
-{
-  vertex_descriptor vertex = add_vertex(context);
-  vertex_descriptor top_vertex =
-    vertex_stack.empty() ? mp.get_root_vertex() : vertex_stack.top();
-
-  mp.add_edge(top_vertex, vertex, kind, point_of_instantiation);
-  vertex_stack.push(vertex);
-}
-
-void metaprogram_builder::handle_template_end(
-  instantiation_kind /* kind */,
-  double /* timestamp */,
-  unsigned long long /* memory_usage */)
-{
-  if (vertex_stack.empty()) {
-    throw exception(
-        "Mismatched Templight TemplateBegin and TemplateEnd events");
-  }
-  vertex_stack.pop();
-}
-
-const metaprogram& metaprogram_builder::get_metaprogram() const {
-  if (!vertex_stack.empty()) {
-    throw exception(
-        "Some Templight TemplateEnd events are missing");
-  }
-  return mp;
-}
-
-metaprogram_builder::vertex_descriptor metaprogram_builder::add_vertex(
-    const std::string& context)
-{
-  element_vertex_map_t::iterator pos;
-  bool inserted;
-
-  std::tie(pos, inserted) = element_vertex_map.insert(
-      std::make_pair(context, vertex_descriptor()));
-
-  if (inserted) {
-    pos->second = mp.add_vertex(context);
-  }
-  return pos->second;
-}
-
 file_location file_location_from_string(const std::string& str) {
   std::vector<std::string> parts;
   boost::algorithm::split(parts, str, boost::algorithm::is_any_of("|"));
@@ -162,41 +78,431 @@ instantiation_kind instantiation_kind_from_string(const std::string& str) {
   return it->second;
 }
 
+// Pull parser reading the xml input incrementally. Only the currently open
+// element names and the last token are kept in memory, so the size of the
+// trace does not matter.
+class xml_reader {
+public:
+  enum class token {
+    start_element,
+    end_element,
+    text,
+    end_of_document
+  };
+
+  explicit xml_reader(std::istream& stream);
+
+  token next();
+
+  // Valid after start_element and end_element
+  const std::string& name() const;
+  // Valid after text
+  const std::string& text() const;
+  // Valid after start_element
+  const std::string* attribute(const std::string& attribute_name) const;
+
+private:
+  typedef std::pair<std::string, std::string> attribute_t;
+
+  int peek();
+  char get();
+  void expect(char c);
+  void skip_whitespace();
+  void skip_until(const std::string& terminator);
+  bool skip_if(const std::string& prefix);
+
+  std::string read_name();
+  void read_reference(std::string& out);
+  void read_start_element();
+  void read_end_element();
+
+  std::streambuf* buffer;
+
+  std::string current_name;
+  std::string current_text;
+  std::vector<attribute_t> attributes;
+
+  std::vector<std::string> open_elements;
+  bool pending_end_element = false;
+};
+
+xml_reader::xml_reader(std::istream& stream) :
+  buffer(stream.rdbuf())
+{}
+
+xml_reader::token xml_reader::next() {
+  if (pending_end_element) {
+    pending_end_element = false;
+    open_elements.pop_back();
+    return token::end_element;
+  }
+
+  current_text.clear();
+  for (;;) {
+    const int c = peek();
+    if (c == std::char_traits<char>::eof()) {
+      if (!open_elements.empty()) {
+        throw exception("templight xml parse failed (unexpected end of file)");
+      }
+      return token::end_of_document;
+    } else if (c == '&') {
+      get();
+      read_reference(current_text);
+    } else if (c != '<') {
+      current_text += get();
+    } else if (!current_text.empty()) {
+      return token::text;
+    } else {
+      get();
+      if (skip_if("?")) {
+        skip_until("?>");
+      } else if (skip_if("!--")) {
+        skip_until("-->");
+      } else if (skip_if("![CDATA[")) {
+        std::string::size_type n = 0;
+        while (n < 3 || current_text.compare(n - 3, 3, "]]>") != 0) {
+          if (peek() == std::char_traits<char>::eof()) {
+            throw exception("templight xml parse failed (unterminated CDATA)");
+          }
+          current_text += get();
+          ++n;
+        }
+        current_text.resize(n - 3);
+        if (!current_text.empty()) {
+          return token::text;
+        }
+      } else if (skip_if("!")) {
+        skip_until(">");
+      } else if (skip_if("/")) {
+        read_end_element();
+        return token::end_element;
+      } else {
+        read_start_element();
+        return token::start_element;
+      }
+    }
+  }
+}
+
+const std::string& xml_reader::name() const {
+  return current_name;
+}
+
+const std::string& xml_reader::text() const {
+  return current_text;
+}
+
+const std::string* xml_reader::attribute(
+    const std::string& attribute_name) const
+{
+  for (const attribute_t& attr : attributes) {
+    if (attr.first == attribute_name) {
+      return &attr.second;
+    }
+  }
+  return nullptr;
+}
+
+int xml_reader::peek() {
+  return buffer->sgetc();
+}
+
+char xml_reader::get() {
+  const int c = buffer->sbumpc();
+  if (c == std::char_traits<char>::eof()) {
+    throw exception("templight xml parse failed (unexpected end of file)");
+  }
+  return std::char_traits<char>::to_char_type(c);
+}
+
+void xml_reader::expect(char c) {
+  if (get() != c) {
+    throw exception(
+        std::string("templight xml parse failed (expected '") + c + "')");
+  }
+}
+
+void xml_reader::skip_whitespace() {
+  for (;;) {
+    const int c = peek();
+    if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+      return;
+    }
+    get();
+  }
+}
+
+void xml_reader::skip_until(const std::string& terminator) {
+  std::string::size_type matched = 0;
+  while (matched != terminator.size()) {
+    const char c = get();
+    if (c == terminator[matched]) {
+      ++matched;
+    } else {
+      matched = (c == terminator[0]) ? 1 : 0;
+    }
+  }
+}
+
+bool xml_reader::skip_if(const std::string& prefix) {
+  // Only the first character is looked ahead, the markup this is used for
+  // can not be confused with each other after that.
+  if (peek() != std::char_traits<char>::to_int_type(prefix[0])) {
+    return false;
+  }
+  for (char c : prefix) {
+    expect(c);
+  }
+  return true;
+}
+
+std::string xml_reader::read_name() {
+  std::string name;
+  for (;;) {
+    const int c = peek();
+    if (
+      c == std::char_traits<char>::eof() ||
+      c == ' ' || c == '\t' || c == '\n' || c == '\r' ||
+      c == '=' || c == '/' || c == '>')
+    {
+      break;
+    }
+    name += get();
+  }
+  if (name.empty()) {
+    throw exception("templight xml parse failed (missing name)");
+  }
+  return name;
+}
+
+void xml_reader::read_reference(std::string& out) {
+  std::string ref;
+  for (char c = get(); c != ';'; c = get()) {
+    ref += c;
+  }
+
+  if (ref == "lt") {
+    out += '<';
+  } else if (ref == "gt") {
+    out += '>';
+  } else if (ref == "amp") {
+    out += '&';
+  } else if (ref == "quot") {
+    out += '"';
+  } else if (ref == "apos") {
+    out += '\'';
+  } else if (ref.size() > 1 && ref[0] == '#') {
+    unsigned long code;
+    try {
+      code =
+        ref[1] == 'x' ?
+          std::stoul(ref.substr(2), nullptr, 16) :
+          std::stoul(ref.substr(1));
+    } catch (const std::exception&) {
+      throw exception("templight xml parse failed (invalid reference)");
+    }
+    // UTF-8 encoding of the code point
+    if (code < 0x80) {
+      out += char(code);
+    } else if (code < 0x800) {
+      out += char(0xC0 | (code >> 6));
+      out += char(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+      out += char(0xE0 | (code >> 12));
+      out += char(0x80 | ((code >> 6) & 0x3F));
+      out += char(0x80 | (code & 0x3F));
+    } else {
+      out += char(0xF0 | (code >> 18));
+      out += char(0x80 | ((code >> 12) & 0x3F));
+      out += char(0x80 | ((code >> 6) & 0x3F));
+      out += char(0x80 | (code & 0x3F));
+    }
+  } else {
+    throw exception("templight xml parse failed (unknown entity)");
+  }
+}
+
+void xml_reader::read_start_element() {
+  current_name = read_name();
+  attributes.clear();
+
+  for (;;) {
+    skip_whitespace();
+    if (skip_if(">")) {
+      break;
+    } else if (skip_if("/")) {
+      expect('>');
+      pending_end_element = true;
+      break;
+    }
+
+    attribute_t attr;
+    attr.first = read_name();
+    skip_whitespace();
+    expect('=');
+    skip_whitespace();
+    const char quote = get();
+    if (quote != '"' && quote != '\'') {
+      throw exception("templight xml parse failed (unquoted attribute)");
+    }
+    for (char v = get(); v != quote; v = get()) {
+      if (v == '&') {
+        read_reference(attr.second);
+      } else {
+        attr.second += v;
+      }
+    }
+    attributes.push_back(std::move(attr));
+  }
+  open_elements.push_back(current_name);
+}
+
+void xml_reader::read_end_element() {
+  current_name = read_name();
+  skip_whitespace();
+  expect('>');
+
+  if (open_elements.empty() || open_elements.back() != current_name) {
+    throw exception(
+        "templight xml parse failed (unexpected closing tag \"" +
+        current_name + "\")");
+  }
+  open_elements.pop_back();
+}
+
+// The content of a TemplateBegin or TemplateEnd node
+struct templight_xml_event {
+  boost::optional<std::string> kind;
+  boost::optional<std::string> context;
+  boost::optional<std::string> point_of_instantiation;
+  boost::optional<std::string> timestamp;
+  boost::optional<std::string> memory_usage;
+};
+
+const std::string& get_required(
+    const boost::optional<std::string>& value,
+    const std::string& name)
+{
+  if (!value) {
+    throw exception("templight xml parse failed (missing " + name + ")");
+  }
+  return *value;
+}
+
+template <class T>
+T get_required_as(
+    const boost::optional<std::string>& value,
+    const std::string& name)
+{
+  try {
+    return boost::lexical_cast<T>(get_required(value, name));
+  } catch (const boost::bad_lexical_cast&) {
+    throw exception("templight xml parse failed (invalid " + name + ")");
+  }
+}
+
 metaprogram metaprogram::create_from_xml_stream(
     std::istream& stream,
     const std::string& root_name,
     const std::string& evaluation_result)
 {
-  typedef boost::property_tree::ptree ptree;
-
-  ptree pt;
-  read_xml(stream, pt);
+  // The depth of the elements:
+  //   1: Trace
+  //   2: TemplateBegin or TemplateEnd
+  //   3: the properties of the event
+  enum { trace_depth = 1, event_depth = 2, property_depth = 3 };
 
   metaprogram_builder builder(root_name, evaluation_result);
 
-  for (const ptree::value_type& pt_event :
-      boost::make_iterator_range(pt.get_child("Trace")))
-  {
-    if (pt_event.first == "TemplateBegin") {
-      builder.handle_template_begin(
-          instantiation_kind_from_string(
-            pt_event.second.get<std::string>("Kind")),
-          pt_event.second.get<std::string>("Context.<xmlattr>.context"),
-          file_location_from_string(
-            pt_event.second.get<std::string>("PointOfInstantiation")),
-          pt_event.second.get<double>("TimeStamp.<xmlattr>.time"),
-          pt_event.second.get<unsigned long long>("MemoryUsage.<xmlattr>.bytes"));
-    } else if (pt_event.first == "TemplateEnd") {
-      builder.handle_template_end(
-          instantiation_kind_from_string(
-            pt_event.second.get<std::string>("Kind")),
-          pt_event.second.get<double>("TimeStamp.<xmlattr>.time"),
-          pt_event.second.get<unsigned long long>("MemoryUsage.<xmlattr>.bytes"));
-    } else {
-      throw exception("Unknown templight xml node \"" + pt_event.first + "\"");
+  xml_reader reader(stream);
+
+  bool trace_found = false;
+  int depth = 0;
+  bool begin_event = false;
+  templight_xml_event event;
+  boost::optional<std::string>* text_target = nullptr;
+
+  for (;;) {
+    switch (reader.next()) {
+    case xml_reader::token::start_element:
+      ++depth;
+      if (depth == trace_depth) {
+        if (reader.name() != "Trace") {
+          throw exception(
+              "templight xml parse failed (missing Trace node)");
+        }
+        trace_found = true;
+      } else if (depth == event_depth) {
+        if (reader.name() == "TemplateBegin") {
+          begin_event = true;
+        } else if (reader.name() == "TemplateEnd") {
+          begin_event = false;
+        } else {
+          throw exception(
+              "Unknown templight xml node \"" + reader.name() + "\"");
+        }
+        event = templight_xml_event();
+      } else if (depth == property_depth) {
+        text_target = nullptr;
+        if (reader.name() == "Kind") {
+          text_target = &event.kind;
+          event.kind = std::string();
+        } else if (reader.name() == "PointOfInstantiation") {
+          text_target = &event.point_of_instantiation;
+          event.point_of_instantiation = std::string();
+        } else if (reader.name() == "Context") {
+          if (const std::string* context = reader.attribute("context")) {
+            event.context = *context;
+          }
+        } else if (reader.name() == "TimeStamp") {
+          if (const std::string* time = reader.attribute("time")) {
+            event.timestamp = *time;
+          }
+        } else if (reader.name() == "MemoryUsage") {
+          if (const std::string* bytes = reader.attribute("bytes")) {
+            event.memory_usage = *bytes;
+          }
+        }
+      }
+      break;
+    case xml_reader::token::text:
+      if (depth == property_depth && text_target) {
+        **text_target += reader.text();
+      }
+      break;
+    case xml_reader::token::end_element:
+      if (depth == property_depth) {
+        text_target = nullptr;
+      } else if (depth == event_depth) {
+        if (begin_event) {
+          builder.handle_template_begin(
+              instantiation_kind_from_string(
+                get_required(event.kind, "Kind")),
+              get_required(event.context, "Context"),
+              file_location_from_string(
+                get_required(
+                  event.point_of_instantiation, "PointOfInstantiation")),
+              get_required_as<double>(event.timestamp, "TimeStamp"),
+              get_required_as<unsigned long long>(
+                event.memory_usage, "MemoryUsage"));
+        } else {
+          builder.handle_template_end(
+              instantiation_kind_from_string(
+                get_required(event.kind, "Kind")),
+              get_required_as<double>(event.timestamp, "TimeStamp"),
+              get_required_as<unsigned long long>(
+                event.memory_usage, "MemoryUsage"));
+        }
+      }
+      --depth;
+      break;
+    case xml_reader::token::end_of_document:
+      if (!trace_found) {
+        throw exception("templight xml parse failed (missing Trace node)");
+      }
+      return builder.release_metaprogram();
     }
   }
-  return builder.get_metaprogram();
 }
 
 metaprogram metaprogram::create_from_xml_file(
@@ -0,0 +1,186 @@
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/metaprogram_profile.hpp>
+
+#include <map>
+#include <stack>
+#include <utility>
+#include <algorithm>
+
+namespace metashell {
+
+namespace {
+
+bool is_profiled(const metaprogram::edge_property& property) {
+  return property.enabled && property.kind != instantiation_kind::memoization;
+}
+
+void add_to_entry(
+    profile_entry& entry,
+    const metaprogram::edge_property& property,
+    bool add_total = true)
+{
+  ++entry.count;
+  entry.self_time += property.self_time;
+  entry.self_memory_usage += property.self_memory_usage;
+  if (add_total) {
+    entry.total_time += property.time_taken;
+    entry.memory_usage += property.memory_usage;
+  }
+}
+
+// Marks the edges instantiating a template while an other instance of the
+// same template is being instantiated (eg. the steps of a recursion). Their
+// total cost is part of the total cost of the outermost instance.
+std::vector<bool> nested_in_same_template(
+    const metaprogram& mp,
+    const std::vector<std::string>& templates)
+{
+  std::vector<bool> result(mp.get_num_edges(), false);
+
+  // The number of instances of the templates on the current path
+  std::map<std::string, unsigned> active;
+
+  // (edge, leaving the edge)
+  std::stack<std::pair<metaprogram::edge_descriptor, bool>> to_visit;
+  metaprogram::discovered_t discovered(mp.get_num_vertices());
+
+  auto push_out_edges = [&](metaprogram::vertex_descriptor vertex) {
+    discovered[vertex] = true;
+    for (metaprogram::edge_descriptor edge : mp.get_out_edges(vertex)) {
+      to_visit.push(std::make_pair(edge, false));
+    }
+  };
+
+  push_out_edges(mp.get_root_vertex());
+
+  while (!to_visit.empty()) {
+    const metaprogram::edge_descriptor edge = to_visit.top().first;
+    const bool leaving = to_visit.top().second;
+    to_visit.pop();
+
+    const metaprogram::vertex_descriptor target = mp.get_target(edge);
+    unsigned& instances = active[templates[target]];
+    if (leaving) {
+      --instances;
+    } else {
+      result[edge] = instances > 0;
+      ++instances;
+      to_visit.push(std::make_pair(edge, true));
+
+      if (!discovered[target]) {
+        push_out_edges(target);
+      }
+    }
+  }
+  return result;
+}
+
+void sort_profile(std::vector<profile_entry>& entries, profile_order order) {
+  std::stable_sort(
+      entries.begin(), entries.end(),
+      [order](const profile_entry& a, const profile_entry& b) {
+        switch (order) {
+        case profile_order::self_time:
+          return a.self_time > b.self_time;
+        case profile_order::total_time:
+          return a.total_time > b.total_time;
+        case profile_order::count:
+          return a.count > b.count;
+        case profile_order::memory:
+          return a.self_memory_usage > b.self_memory_usage;
+        }
+        return false;
+      });
+}
+
+}
+
+std::string template_name(const std::string& type) {
+  std::string result;
+  int depth = 0;
+  for (char c : type) {
+    if (c == '<') {
+      ++depth;
+    } else if (c == '>' && depth > 0) {
+      --depth;
+    } else if (depth == 0) {
+      result += c;
+    }
+  }
+  return result;
+}
+
+std::vector<profile_entry> profile_instantiations(
+    const metaprogram& mp,
+    profile_order order)
+{
+  std::vector<profile_entry> by_vertex(mp.get_num_vertices());
+
+  for (metaprogram::edge_descriptor edge : mp.get_edges()) {
+    const metaprogram::edge_property& property = mp.get_edge_property(edge);
+    if (is_profiled(property)) {
+      add_to_entry(by_vertex[mp.get_target(edge)], property);
+    }
+  }
+
+  std::vector<profile_entry> result;
+  for (metaprogram::vertex_descriptor vertex : mp.get_vertices()) {
+    if (by_vertex[vertex].count > 0) {
+      result.push_back(by_vertex[vertex]);
+      result.back().name = mp.get_vertex_property(vertex).name;
+    }
+  }
+  sort_profile(result, order);
+  return result;
+}
+
+std::vector<profile_entry> profile_templates(
+    const metaprogram& mp,
+    profile_order order)
+{
+  std::vector<std::string> templates;
+  templates.reserve(mp.get_num_vertices());
+  for (metaprogram::vertex_descriptor vertex : mp.get_vertices()) {
+    templates.push_back(template_name(mp.get_vertex_property(vertex).name));
+  }
+
+  const std::vector<bool> nested = nested_in_same_template(mp, templates);
+
+  std::map<std::string, profile_entry> by_template;
+
+  for (metaprogram::edge_descriptor edge : mp.get_edges()) {
+    const metaprogram::edge_property& property = mp.get_edge_property(edge);
+    if (is_profiled(property)) {
+      const std::string& name = templates[mp.get_target(edge)];
+      profile_entry& entry = by_template[name];
+      entry.name = name;
+      add_to_entry(entry, property, !nested[edge]);
+    }
+  }
+
+  std::vector<profile_entry> result;
+  for (const auto& p : by_template) {
+    result.push_back(p.second);
+  }
+  sort_profile(result, order);
+  return result;
+}
+
+}
+
@@ -15,39 +15,191 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <metashell/metashell.hpp>
+#include <metashell/timing.hpp>
 #include "get_type_of_variable.hpp"
 #include "cxindex.hpp"
 
 #include <metashell/command.hpp>
+#include <metashell/to_string.hpp>
 
 #include <boost/algorithm/string/predicate.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <fstream>
 #include <memory>
+#include <sstream>
+#include <vector>
 
 using namespace metashell;
 
 namespace
 {
   const char* var = "__metashell_v";
+  const char* formatted_var = "__metashell_formatted_v";
 
-  std::pair<std::unique_ptr<cxtranslationunit>, std::string> parse_expr(
+  // The formatted and the unformatted result are calculated in the same
+  // translation unit. This error is emitted between the two parts to tell
+  // which diagnostics belong to which one.
+  const char* formatted_part_separator = "__metashell_formatted_part";
+
+  // When multiple queries are evaluated in the same translation unit, these
+  // errors followed by the index of the query are emitted before the parts
+  // of the queries.
+  const char* query_separator = "__metashell_query_";
+  const char* formatted_query_separator = "__metashell_formatted_query_";
+
+  std::string numbered(const std::string& s_, int n_)
+  {
+    std::ostringstream s;
+    s << s_ << n_;
+    return s.str();
+  }
+
+  std::string wrapped_expr(const std::string& tmp_exp_, const std::string& var_)
+  {
+    return "::metashell::impl::wrap< " + tmp_exp_ + " > " + var_ + ";\n";
+  }
+
+  std::string formatted_expr(const std::string& tmp_exp_)
+  {
+    return "::metashell::format<" + tmp_exp_ + ">::type";
+  }
+
+  // The code of the environment is included by the main file
+  unsaved_file appended_code(
+    const std::string& input_filename_,
+    const std::string& s_
+  )
+  {
+    timed_stage t("environment");
+    return
+      unsaved_file(
+        input_filename_,
+        cxtranslationunit::environment_include() + s_
+      );
+  }
+
+  // The code of the environment followed by the evaluated code. It is built
+  // only in verbose mode.
+  std::string info_of(
+    const config& config_,
+    const environment& env_,
+    const std::string& s_
+  )
+  {
+    return config_.verbose ? env_.get_appended(s_) : "";
+  }
+
+  cxtranslationunit& timed_reparse(
+    cxindex& index_,
+    const unsaved_file& code_,
+    const environment& env_
+  )
+  {
+    cxtranslationunit* tu = 0;
+    {
+      timed_stage t("parse");
+      tu = &index_.reparse_code(code_, env_);
+    }
+
+    if (timing* t = timing_recorder::current())
+    {
+      typedef std::pair<std::string, unsigned long> resource;
+      for (const resource& r : tu->resource_usage())
+      {
+        t->add_resource_usage(r.first, r.second);
+      }
+    }
+
+    return *tu;
+  }
+
+  std::vector<std::string> collect_errors(const cxtranslationunit& tu_)
+  {
+    timed_stage t("diagnostics");
+    return std::vector<std::string>(tu_.errors_begin(), tu_.errors_end());
+  }
+
+  std::pair<cxtranslationunit*, std::string> parse_appended(
     cxindex& index_,
     const std::string& input_filename_,
     const environment& env_,
-    const std::string& tmp_exp_
+    const std::string& s_
   )
   {
     using std::make_pair;
 
-    const unsaved_file
-      code(
+    const unsaved_file code = appended_code(input_filename_, s_);
+    return make_pair(&timed_reparse(index_, code, env_), code.content());
+  }
+
+  std::pair<cxtranslationunit*, std::string> parse_expr(
+    cxindex& index_,
+    const std::string& input_filename_,
+    const environment& env_,
+    const std::string& tmp_exp_
+  )
+  {
+    return
+      parse_appended(
+        index_,
         input_filename_,
-        env_.get_appended(
-          "::metashell::impl::wrap< " + tmp_exp_ + " > " + var + ";\n"
-        )
+        env_,
+        wrapped_expr(tmp_exp_, var)
       );
-    return make_pair(index_.parse_code(code, env_), code.content());
+  }
+
+  // The declaration of the variable is looked up at the location it was
+  // declared at. The AST is walked only when that fails.
+  std::string type_of_variable(
+    cxtranslationunit& tu_,
+    const std::string& code_,
+    const std::string& var_
+  )
+  {
+    timed_stage t("type lookup");
+
+    get_type_of_variable v(var_);
+
+    const std::string::size_type pos = code_.rfind(" " + var_ + ";");
+    if (pos != std::string::npos)
+    {
+      const cxcursor cursor = tu_.cursor_at(pos + 1);
+      if (cursor.kind() == CXCursor_VarDecl && cursor.spelling() == var_)
+      {
+        v(cursor);
+        return v.result();
+      }
+    }
+
+    tu_.visit_nodes([&v](cxcursor cursor_, cxcursor) { v(cursor_); });
+    return v.result();
+  }
+
+  bool is_formatted_part_separator(const std::string& error_)
+  {
+    return boost::algorithm::ends_with(error_, formatted_part_separator);
+  }
+
+  // Returns the index of the query the separator error belongs to or -1 when
+  // error_ is not a separator of the given kind.
+  int separator_index(const std::string& error_, const std::string& separator_)
+  {
+    const std::string::size_type pos = error_.rfind(separator_);
+    if (pos == std::string::npos)
+    {
+      return -1;
+    }
+    else
+    {
+      const std::string n = error_.substr(pos + separator_.size());
+      return
+        !n.empty() && std::all_of(n.begin(), n.end(), ::isdigit) ?
+          std::atoi(n.c_str()) :
+          -1;
+    }
   }
 
   bool has_typedef(
@@ -87,19 +239,26 @@ result metashell::validate_code(
   const environment& env_,
   const std::string& input_filename_
 )
+{
+  cxindex index;
+  return validate_code(index, src_, config_, env_, input_filename_);
+}
+
+result metashell::validate_code(
+  cxindex& index_,
+  const std::string& src_,
+  const config& config_,
+  const environment& env_,
+  const std::string& input_filename_
+)
 {
   try
   {
-    const unsaved_file src(input_filename_, env_.get_appended(src_));
-    cxindex index;
-    std::unique_ptr<cxtranslationunit> tu = index.parse_code(src, env_);
+    const unsaved_file src = appended_code(input_filename_, src_);
+    const std::vector<std::string>
+      errors = collect_errors(timed_reparse(index_, src, env_));
     return
-      result(
-        "",
-        tu->errors_begin(),
-        tu->errors_end(),
-        config_.verbose ? src.content() : ""
-      );
+      result("", errors.begin(), errors.end(), info_of(config_, env_, src_));
   }
   catch (const std::exception& e)
   {
@@ -114,68 +273,232 @@ result metashell::eval_tmp_formatted(
   const config& config_,
   const std::string& input_filename_
 )
+{
+  cxindex index;
+  return eval_tmp_formatted(index, env_, tmp_exp_, config_, input_filename_);
+}
+
+result metashell::eval_tmp_formatted(
+  cxindex& index_,
+  const environment& env_,
+  const std::string& tmp_exp_,
+  const config& config_,
+  const std::string& input_filename_
+)
 {
   using std::string;
   using std::pair;
+  using std::vector;
 
-  typedef std::unique_ptr<cxtranslationunit> tup;
+  const string code =
+    wrapped_expr(tmp_exp_, var)
+    + "#error " + formatted_part_separator + "\n"
+    + wrapped_expr(formatted_expr(tmp_exp_), formatted_var);
 
-  cxindex index;
+  const pair<cxtranslationunit*, string> final_pair =
+    parse_appended(index_, input_filename_, env_, code);
 
-  pair<tup, string> simple = parse_expr(index, input_filename_, env_, tmp_exp_);
+  const vector<string> errors = collect_errors(*final_pair.first);
+  const vector<string>::const_iterator separator =
+    std::find_if(errors.begin(), errors.end(), is_formatted_part_separator);
 
-  const pair<tup, string> final_pair =
-    simple.first->has_errors() ?
-      std::move(simple) :
-      parse_expr(
-        index,
-        input_filename_,
-        env_,
-        "::metashell::format<" + tmp_exp_ + ">::type"
-      );
+  const string info = info_of(config_, env_, code);
 
-  get_type_of_variable v(var);
-  final_pair.first->visit_nodes(
-    [&v](cxcursor cursor_, cxcursor) { v(cursor_); }
-  );
+  // The errors of the formatted part are displayed only when the
+  // unformatted part was successful.
+  if (separator == errors.begin() && separator != errors.end())
+  {
+    return
+      result(
+        type_of_variable(*final_pair.first, final_pair.second, formatted_var),
+        separator + 1,
+        errors.end(),
+        info
+      );
+  }
+  else
+  {
+    return
+      result(
+        type_of_variable(*final_pair.first, final_pair.second, var),
+        errors.begin(),
+        separator,
+        info
+      );
+  }
+}
 
-  return
-    result(
-      v.result(),
-      final_pair.first->errors_begin(),
-      final_pair.first->errors_end(),
-      config_.verbose ? final_pair.second : ""
-    );
+std::vector<result> metashell::eval_tmp_formatted(
+  const environment& env_,
+  const std::vector<std::string>& tmp_exps_,
+  const config& config_,
+  const std::string& input_filename_
+)
+{
+  cxindex index;
+  return eval_tmp_formatted(index, env_, tmp_exps_, config_, input_filename_);
 }
 
-result metashell::eval_tmp_unformatted(
+std::vector<result> metashell::eval_tmp_formatted(
+  cxindex& index_,
   const environment& env_,
-  const std::string& tmp_exp_,
+  const std::vector<std::string>& tmp_exps_,
   const config& config_,
   const std::string& input_filename_
 )
 {
   using std::string;
   using std::pair;
+  using std::vector;
+
+  const int n = tmp_exps_.size();
+
+  std::ostringstream code;
+  for (int i = 0; i != n; ++i)
+  {
+    code
+      << "#error " << query_separator << i << "\n"
+      << wrapped_expr(tmp_exps_[i], numbered(var, i))
+      << "#error " << formatted_query_separator << i << "\n"
+      << wrapped_expr(formatted_expr(tmp_exps_[i]), numbered(formatted_var, i));
+  }
 
-  typedef std::unique_ptr<cxtranslationunit> tup;
+  const pair<cxtranslationunit*, string> final_pair =
+    parse_appended(index_, input_filename_, env_, code.str());
 
+  // parts[0] contains the errors coming from the environment, parts[2i + 1]
+  // and parts[2i + 2] contain the errors of the unformatted and the formatted
+  // part of the ith query.
+  vector<vector<string>> parts(2 * n + 1);
+  vector<bool> separator_found(2 * n + 1, false);
+  separator_found[0] = true;
+
+  int current = 0;
+  for (const string& err : collect_errors(*final_pair.first))
+  {
+    const int q = separator_index(err, query_separator);
+    const int f = separator_index(err, formatted_query_separator);
+    if (0 <= q && q < n)
+    {
+      current = 2 * q + 1;
+      separator_found[current] = true;
+    }
+    else if (0 <= f && f < n)
+    {
+      current = 2 * f + 2;
+      separator_found[current] = true;
+    }
+    else
+    {
+      parts[current].push_back(err);
+    }
+  }
+
+  const string info = info_of(config_, env_, code.str());
+
+  vector<result> results(n);
+  // The queries the errors of which could not be found (eg. because of
+  // reaching the error limit or an error recovery going through multiple
+  // queries) are evaluated one by one.
+  vector<int> reevaluate;
+  for (int i = 0; i != n; ++i)
+  {
+    const vector<string>& unformatted_errors = parts[2 * i + 1];
+    const vector<string>& formatted_errors = parts[2 * i + 2];
+
+    vector<string> errors(parts[0]);
+    errors.insert(
+      errors.end(),
+      unformatted_errors.begin(),
+      unformatted_errors.end()
+    );
+
+    if (!separator_found[2 * i + 1] || !separator_found[2 * i + 2])
+    {
+      reevaluate.push_back(i);
+    }
+    else if (!errors.empty())
+    {
+      results[i] =
+        result(
+          type_of_variable(
+            *final_pair.first,
+            final_pair.second,
+            numbered(var, i)
+          ),
+          errors.begin(),
+          errors.end(),
+          info
+        );
+    }
+    else
+    {
+      const string output =
+        type_of_variable(
+          *final_pair.first,
+          final_pair.second,
+          numbered(formatted_var, i)
+        );
+
+      if (output.empty() && formatted_errors.empty())
+      {
+        reevaluate.push_back(i);
+      }
+      else
+      {
+        results[i] =
+          result(
+            output,
+            formatted_errors.begin(),
+            formatted_errors.end(),
+            info
+          );
+      }
+    }
+  }
+
+  // This reuses the translation unit of the index, therefore it has to be
+  // done after processing the results of the translation unit.
+  for (int i : reevaluate)
+  {
+    results[i] =
+      eval_tmp_formatted(index_, env_, tmp_exps_[i], config_, input_filename_);
+  }
+
+  return results;
+}
+
+result metashell::eval_tmp_unformatted(
+  const environment& env_,
+  const std::string& tmp_exp_,
+  const config& config_,
+  const std::string& input_filename_
+)
+{
   cxindex index;
+  return eval_tmp_unformatted(index, env_, tmp_exp_, config_, input_filename_);
+}
 
-  pair<tup, string> final_pair =
-    parse_expr(index, input_filename_, env_, tmp_exp_);
+result metashell::eval_tmp_unformatted(
+  cxindex& index_,
+  const environment& env_,
+  const std::string& tmp_exp_,
+  const config& config_,
+  const std::string& input_filename_
+)
+{
+  using std::string;
+  using std::pair;
 
-  get_type_of_variable v(var);
-  final_pair.first->visit_nodes(
-    [&v](cxcursor cursor_, cxcursor) { v(cursor_); }
-  );
+  const pair<cxtranslationunit*, string> final_pair =
+    parse_expr(index_, input_filename_, env_, tmp_exp_);
 
   return
     result(
-      v.result(),
+      type_of_variable(*final_pair.first, final_pair.second, var),
       final_pair.first->errors_begin(),
       final_pair.first->errors_end(),
-      config_.verbose ? final_pair.second : ""
+      info_of(config_, env_, wrapped_expr(tmp_exp_, var))
     );
 }
 
@@ -234,6 +557,18 @@ void metashell::code_complete(
   const std::string& input_filename_,
   std::set<std::string>& out_
 )
+{
+  cxindex index;
+  code_complete(index, env_, src_, input_filename_, out_);
+}
+
+void metashell::code_complete(
+  cxindex& index_,
+  const environment& env_,
+  const std::string& src_,
+  const std::string& input_filename_,
+  std::set<std::string>& out_
+)
 {
   using boost::starts_with;
 
@@ -246,19 +581,27 @@ void metashell::code_complete(
   const unsaved_file src(
     input_filename_,
     // code completion doesn't seem to work without that extra space at the end
-    env_.get_appended(completion_start.first + " ")
+    cxtranslationunit::environment_include()
+      + completion_start.first
+      + " "
   );
 
-  set<string> c;
-  cxindex().parse_code(src, env_)->code_complete(c);
+  const set<string>& c = index_.code_complete(src, env_);
 
+  // The candidates are sorted, the ones starting with the prefix form a
+  // continuous range. Removing the common prefix keeps them sorted.
   out_.clear();
-  const int prefix_len = completion_start.second.length();
-  for (const string& s : c)
+  const string& prefix = completion_start.second;
+  const int prefix_len = prefix.length();
+  for (
+    set<string>::const_iterator i = c.lower_bound(prefix), e = c.end();
+    i != e && starts_with(*i, prefix);
+    ++i
+  )
   {
-    if (starts_with(s, completion_start.second) && s != completion_start.second)
+    if (*i != prefix)
     {
-      out_.insert(string(s.begin() + prefix_len, s.end()));
+      out_.insert(out_.end(), string(i->begin() + prefix_len, i->end()));
     }
   }
 }
@@ -334,3 +677,51 @@ bool metashell::is_environment_setup_command(
   }
 }
 
+std::string metashell::default_environment()
+{
+  return
+    "#define __METASHELL\n"
+    "#define __METASHELL_MAJOR " TO_STRING(METASHELL_MAJOR) "\n"
+    "#define __METASHELL_MINOR " TO_STRING(METASHELL_MINOR) "\n"
+    "#define __METASHELL_PATCH " TO_STRING(METASHELL_PATCH) "\n"
+
+    "namespace metashell { "
+      "namespace impl { "
+        "template <class T> "
+        "struct wrap {}; "
+
+        "template <class T> "
+        "typename T::tag* tag_of(::metashell::impl::wrap<T>); "
+
+        "void* tag_of(...); "
+
+        "template <class T> "
+        "struct remove_ptr; "
+
+        "template <class T> "
+        "struct remove_ptr<T*> { typedef T type; }; "
+      "} "
+
+      "template <class Tag> "
+      "struct format_impl "
+      "{ "
+        "typedef format_impl type; "
+
+        "template <class T> "
+        "struct apply { typedef T type; }; "
+      "}; "
+
+      "template <class T> "
+      "struct format : "
+        "::metashell::format_impl<"
+          "typename ::metashell::impl::remove_ptr<"
+            "decltype(::metashell::impl::tag_of(::metashell::impl::wrap<T>()))"
+          ">::type"
+        ">::template apply<T>"
+        "{}; "
+
+      ""
+    "}"
+    "\n";
+}
+
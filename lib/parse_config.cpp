@@ -165,8 +165,14 @@ parse_config_result metashell::parse_config(
   const int argc = minus_minus - argv_;
 
   std::string cppstd("c++0x");
+  std::string templight_format_name("xml");
   ucfg.use_precompiled_headers = !ucfg.clang_path.empty();
   std::string fvalue;
+  std::string evaluate_all_file;
+  std::string batch_file;
+  int jobs = 0;
+  std::string server_socket;
+  std::string default_pch_dir;
 
   options_description desc("Options");
   desc.add_options()
@@ -208,6 +214,94 @@ parse_config_result metashell::parse_config(
       "enable_saving",
       "Enable saving the environment using the #msh environment save"
     )
+    (
+      "evaluate_all", value(&evaluate_all_file),
+      "Evaluate the metaprograms listed in a file (one per line) in one"
+      " translation unit, display their results and exit."
+    )
+    (
+      "batch", value(&batch_file),
+      "Process the lines of a file (- for the standard input) the same way"
+      " the shell does, evaluate the independent queries in parallel,"
+      " display their results in order and exit."
+    )
+    (
+      "jobs,j", value(&jobs),
+      "The number of worker threads to use in batch mode. 0 means the number"
+      " of available cores."
+    )
+    (
+      "server", value(&server_socket),
+      "Keep the environment parsed and process newline-delimited JSON"
+      " requests arriving on a Unix domain socket until a shutdown request."
+    )
+    (
+      "build_default_pch", value(&default_pch_dir),
+      "Precompile the default environment into a directory and exit. Used"
+      " by the build."
+    )
+    (
+      "evaluation_cache_size", value(&ucfg.evaluation_cache_size),
+      "The maximum number of evaluation results to remember. 0 disables"
+      " caching."
+    )
+    (
+      "evaluator_processes", value(&ucfg.evaluator_processes),
+      "Evaluate the queries in this many separate processes, so a crashing"
+      " or exploding metaprogram does not take the shell down. 0 evaluates"
+      " them in the shell, where Ctrl-C can not interrupt them."
+    )
+    (
+      "evaluator_memory_limit", value(&ucfg.evaluator_memory_limit_mb),
+      "The memory an evaluator process may use in MB. 0 means no limit."
+    )
+    (
+      "evaluator_timeout", value(&ucfg.evaluator_timeout_sec),
+      "The number of seconds an evaluation may take in an evaluator process."
+      " 0 means no limit."
+    )
+    (
+      "evaluator_queries_per_process",
+      value(&ucfg.evaluator_queries_per_process),
+      "Replace an evaluator process after it has evaluated this many queries."
+      " 0 means no limit."
+    )
+    (
+      "validate_declarations_only",
+      "Skip the function bodies when checking the code added to the"
+      " environment. Use #msh environment check for a full check."
+    )
+    (
+      "pch_cache_dir", value(&ucfg.pch_cache_dir),
+      "Store the precompiled headers in this directory and reuse them in"
+      " later shells."
+    )
+    (
+      "pch_cache_size", value(&ucfg.pch_cache_size_mb),
+      "The size limit of the precompiled header cache in MB. The least"
+      " recently used headers are removed above it. 0 means no limit."
+    )
+    (
+      "precompile_in_process",
+      "Build the precompiled headers using libclang instead of running the"
+      " clang binary."
+    )
+    (
+      "redetect",
+      "Detect the system include path and the compatibility of clang and"
+      " libclang again instead of using the results of the previous shells."
+    )
+    (
+      "templight_format", value(&templight_format_name),
+      "The format of the template instantiation traces mdb reads. Possible"
+      " values: xml (the default), binary (needs a templight supporting"
+      " it)."
+    )
+    (
+      "templight_memory",
+      "Record the memory usage of the template instantiations in mdb for the"
+      " profile command. It makes the evaluation slower."
+    )
     ;
 
   try
@@ -223,6 +317,12 @@ parse_config_result metashell::parse_config(
     ucfg.warnings_enabled = !(vm.count("no_warnings") || vm.count("w"));
     ucfg.use_precompiled_headers = !vm.count("no_precompiled_headers");
     ucfg.saving_enabled = vm.count("enable_saving");
+    ucfg.validate_declarations_only =
+      vm.count("validate_declarations_only") != 0;
+    ucfg.precompile_in_process = vm.count("precompile_in_process") != 0;
+    ucfg.redetect = vm.count("redetect") != 0;
+    ucfg.templight_trace_format = parse_templight_format(templight_format_name);
+    ucfg.templight_memory = vm.count("templight_memory") != 0;
 
     if (!fvalue.empty())
     {
@@ -247,6 +347,28 @@ parse_config_result metashell::parse_config(
       show_mdb_help();
       return parse_config_result::exit(false);
     }
+    else if (!evaluate_all_file.empty())
+    {
+      return
+        parse_config_result::start_evaluate_all(ucfg, evaluate_all_file);
+    }
+    else if (!batch_file.empty())
+    {
+      if (jobs < 0)
+      {
+        throw std::runtime_error("The number of jobs can not be negative.");
+      }
+      return parse_config_result::start_batch(ucfg, batch_file, jobs);
+    }
+    else if (!server_socket.empty())
+    {
+      return parse_config_result::start_server(ucfg, server_socket);
+    }
+    else if (!default_pch_dir.empty())
+    {
+      return
+        parse_config_result::start_build_default_pch(ucfg, default_pch_dir);
+    }
     else
     {
       return parse_config_result::start_shell(ucfg);
@@ -278,11 +400,81 @@ parse_config_result parse_config_result::start_shell(const user_config& cfg_)
   return r;
 }
 
+parse_config_result parse_config_result::start_evaluate_all(
+  const user_config& cfg_,
+  const std::string& file_
+)
+{
+  parse_config_result r;
+  r.action = evaluate_all;
+  r.cfg = cfg_;
+  r.evaluate_all_file = file_;
+  return r;
+}
+
+parse_config_result parse_config_result::start_batch(
+  const user_config& cfg_,
+  const std::string& file_,
+  int jobs_
+)
+{
+  parse_config_result r;
+  r.action = run_batch;
+  r.cfg = cfg_;
+  r.batch_file = file_;
+  r.jobs = jobs_;
+  return r;
+}
+
+parse_config_result parse_config_result::start_server(
+  const user_config& cfg_,
+  const std::string& socket_
+)
+{
+  parse_config_result r;
+  r.action = run_server;
+  r.cfg = cfg_;
+  r.server_socket = socket_;
+  return r;
+}
+
+parse_config_result parse_config_result::start_build_default_pch(
+  const user_config& cfg_,
+  const std::string& dir_
+)
+{
+  parse_config_result r;
+  r.action = build_default_pch;
+  r.cfg = cfg_;
+  r.default_pch_dir = dir_;
+  return r;
+}
+
 bool parse_config_result::should_run_shell() const
 {
   return action == run_shell;
 }
 
+bool parse_config_result::should_evaluate_all() const
+{
+  return action == evaluate_all;
+}
+
+bool parse_config_result::should_run_batch() const
+{
+  return action == run_batch;
+}
+
+bool parse_config_result::should_run_server() const
+{
+  return action == run_server;
+}
+
+bool parse_config_result::should_build_default_pch() const
+{
+  return action == build_default_pch;
+}
+
 bool parse_config_result::should_error_at_exit() const
 {
   return action == exit_with_error;
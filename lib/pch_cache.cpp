@@ -0,0 +1,583 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/pch_cache.hpp>
+#include <metashell/digest.hpp>
+#include <metashell/headers.hpp>
+#include <metashell/exception.hpp>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <process.h>
+#else
+#  include <signal.h>
+#  include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <utility>
+
+using namespace metashell;
+
+namespace
+{
+  const char deps_extension[] = ".deps";
+  const char pins_dir[] = "pins";
+  const char pin_extension[] = ".pin";
+
+  // SHA-1 of the parts. The cache has to find the same files in every
+  // build and a collision would use the precompiled header of a different
+  // code.
+  class cache_key
+  {
+  public:
+    cache_key& operator<<(const std::string& s_)
+    {
+      // Length prefix, so {"ab", "c"} and {"a", "bc"} have different keys
+      std::ostringstream s;
+      s << s_.size() << ':';
+      _digest.append(s.str());
+      _digest.append(s_);
+      return *this;
+    }
+
+    cache_key& operator<<(std::uintmax_t n_)
+    {
+      std::ostringstream s;
+      s << n_;
+      return *this << s.str();
+    }
+
+    std::string str() const
+    {
+      return _digest.value();
+    }
+  private:
+    digest _digest;
+  };
+
+  std::string read_file(const std::string& fn_)
+  {
+    std::ifstream f(fn_.c_str());
+    return
+      std::string(
+        (std::istreambuf_iterator<char>(f)),
+        std::istreambuf_iterator<char>()
+      );
+  }
+
+  void write_file(const std::string& fn_, const std::string& content_)
+  {
+    std::ofstream f(fn_.c_str());
+    if (f)
+    {
+      f << content_;
+    }
+    else
+    {
+      throw exception("Error creating file " + fn_);
+    }
+  }
+
+  std::string unique_name(const std::string& prefix_)
+  {
+    return
+      prefix_
+      + boost::filesystem::unique_path(".tmp-%%%%-%%%%-%%%%").string();
+  }
+
+  // The files listed as the prerequisites in a Makefile rule generated by
+  // clang -MD
+  std::vector<std::string> prerequisites(const std::string& rule_)
+  {
+    std::vector<std::string> result;
+    bool after_target = false;
+    std::string current;
+    for (std::string::size_type i = 0; i <= rule_.size(); ++i)
+    {
+      const char c = i < rule_.size() ? rule_[i] : ' ';
+      const char next = i + 1 < rule_.size() ? rule_[i + 1] : ' ';
+      if (c == '\\' && (next == ' ' || next == '\n' || next == '\r'))
+      {
+        // Escaped space or line continuation
+        if (next == ' ')
+        {
+          current += ' ';
+        }
+        ++i;
+      }
+      else if (std::isspace(static_cast<unsigned char>(c)))
+      {
+        if (current.empty())
+        {
+          // Nothing to do
+        }
+        else if (after_target)
+        {
+          result.push_back(current);
+        }
+        else if (current[current.size() - 1] == ':')
+        {
+          after_target = true;
+        }
+        current.clear();
+      }
+      else
+      {
+        current += c;
+      }
+    }
+    return result;
+  }
+
+  // Line format: <modification time> <size> <path>
+  std::string describe_dependency(const std::string& path_)
+  {
+    boost::system::error_code ec;
+    const std::time_t mtime = boost::filesystem::last_write_time(path_, ec);
+    const std::uintmax_t size = boost::filesystem::file_size(path_, ec);
+    if (ec)
+    {
+      throw exception("Error checking file " + path_);
+    }
+
+    std::ostringstream s;
+    s << mtime << " " << size << " " << path_ << "\n";
+    return s.str();
+  }
+
+  bool dependency_changed(const std::string& line_)
+  {
+    std::istringstream s(line_);
+    std::time_t mtime;
+    std::uintmax_t size;
+    std::string path;
+    if (s >> mtime >> size && s.get() == ' ' && std::getline(s, path))
+    {
+      try
+      {
+        return describe_dependency(path) != line_ + "\n";
+      }
+      catch (const exception&)
+      {
+        return true;
+      }
+    }
+    else
+    {
+      return true;
+    }
+  }
+
+  std::uintmax_t size_of(const std::string& path_)
+  {
+    boost::system::error_code ec;
+    const std::uintmax_t size = boost::filesystem::file_size(path_, ec);
+    return ec ? 0 : size;
+  }
+
+  std::time_t modification_time(const std::string& path_)
+  {
+    boost::system::error_code ec;
+    const std::time_t t = boost::filesystem::last_write_time(path_, ec);
+    return ec ? 0 : t;
+  }
+
+  void remove_file(const std::string& path_)
+  {
+    boost::system::error_code ec;
+    boost::filesystem::remove(path_, ec);
+  }
+
+#ifdef _WIN32
+  int current_process()
+  {
+    return _getpid();
+  }
+
+  bool process_running(int pid_)
+  {
+    const HANDLE p =
+      OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid_);
+    if (p == NULL)
+    {
+      return false;
+    }
+    DWORD code = 0;
+    const bool running =
+      GetExitCodeProcess(p, &code) && code == STILL_ACTIVE;
+    CloseHandle(p);
+    return running;
+  }
+#else
+  int current_process()
+  {
+    return getpid();
+  }
+
+  bool process_running(int pid_)
+  {
+    return kill(pid_, 0) == 0 || errno == EPERM;
+  }
+#endif
+
+  // The name of a pin file is the id of the process that created it
+  // followed by a unique suffix
+  std::string pin_filename()
+  {
+    std::ostringstream s;
+    s
+      << current_process()
+      << boost::filesystem::unique_path("-%%%%-%%%%-%%%%").string()
+      << pin_extension;
+    return s.str();
+  }
+
+  bool owner_running(const boost::filesystem::path& pin_file_)
+  {
+    std::istringstream s(pin_file_.filename().string());
+    int pid;
+    return s >> pid && s.get() == '-' && process_running(pid);
+  }
+}
+
+pch_cache::pch_cache(const std::string& directory_, int max_size_mb_) :
+  _directory(directory_),
+  _max_size(
+    max_size_mb_ > 0 ? static_cast<unsigned long long>(max_size_mb_) << 20 : 0
+  )
+{
+  // Throws when fails to create the directory
+  boost::filesystem::create_directories(_directory);
+}
+
+pch_cache::pch_cache(const pch_cache& other_) :
+  _directory(other_._directory),
+  _max_size(other_._max_size),
+  _pin_file(),
+  _pinned()
+{
+  std::lock_guard<std::mutex> l(other_._pin_lock);
+  _pinned = other_._pinned;
+  if (!_pinned.empty())
+  {
+    save_pins();
+  }
+}
+
+pch_cache::~pch_cache()
+{
+  if (!_pin_file.empty())
+  {
+    remove_file(_pin_file);
+  }
+}
+
+std::string pch_cache::headers_directory() const
+{
+  const headers generated("");
+
+  cache_key h;
+  for (const unsaved_file& f : generated)
+  {
+    h << f.filename() << f.content();
+  }
+
+  const std::string dir = path_of("headers-" + h.str());
+  if (!boost::filesystem::exists(dir))
+  {
+    // The headers are generated in a temporary directory which is renamed
+    // when it is complete, so other shells see either the complete
+    // directory or nothing.
+    const std::string tmp = unique_name(dir);
+    headers(tmp).generate();
+
+    boost::system::error_code ec;
+    boost::filesystem::rename(tmp, dir, ec);
+    if (ec)
+    {
+      // Another shell has created it in the meantime
+      boost::filesystem::remove_all(tmp, ec);
+    }
+  }
+  return dir;
+}
+
+std::string pch_cache::precompiled_header(
+  const std::string& compiler_,
+  const std::vector<std::string>& clang_args_,
+  const std::string& content_,
+  const precompiler& precompile_
+)
+{
+  cache_key h;
+  h
+    << compiler_
+    << size_of(compiler_)
+    << std::uintmax_t(modification_time(compiler_));
+  for (const std::string& arg : clang_args_)
+  {
+    h << arg;
+  }
+  h << content_;
+
+  const std::string key = h.str();
+  const std::string header = path_of(key + ".hpp");
+  const std::string deps = path_of(key + deps_extension);
+
+  // Pinned before it is checked, so it is not removed after the check
+  pin(key);
+
+  if (up_to_date(key))
+  {
+    // Recording the use for the LRU eviction
+    boost::system::error_code ec;
+    boost::filesystem::last_write_time(deps, std::time(nullptr), ec);
+    return header;
+  }
+
+  if (!boost::filesystem::exists(header))
+  {
+    // Precompiled headers of other shells record the modification time of
+    // the header, therefore an existing header is never overwritten.
+    const std::string tmp = unique_name(header);
+    write_file(tmp, content_);
+    boost::system::error_code ec;
+    boost::filesystem::create_hard_link(tmp, header, ec);
+    if (ec && !boost::filesystem::exists(header))
+    {
+      // The file system does not support hard links
+      boost::filesystem::copy_file(
+        tmp,
+        header,
+        boost::filesystem::copy_option::fail_if_exists,
+        ec
+      );
+    }
+    remove_file(tmp);
+    if (!boost::filesystem::exists(header))
+    {
+      throw exception("Error creating file " + header);
+    }
+  }
+
+  const std::string pch = header + ".pch";
+  const std::string tmp_pch = unique_name(pch);
+  const std::string tmp_rule = unique_name(deps);
+
+  std::vector<std::string> args(clang_args_);
+  args.push_back("-MD");
+  args.push_back("-MF");
+  args.push_back(tmp_rule);
+
+  try
+  {
+    precompile_(args, header, tmp_pch);
+  }
+  catch (...)
+  {
+    remove_file(tmp_pch);
+    remove_file(tmp_rule);
+    throw;
+  }
+
+  std::vector<std::string> dependencies = prerequisites(read_file(tmp_rule));
+  remove_file(tmp_rule);
+  for (
+    auto i = std::find(clang_args_.begin(), clang_args_.end(), "-include-pch");
+    i != clang_args_.end() && i + 1 != clang_args_.end();
+    i = std::find(i + 2, clang_args_.end(), "-include-pch")
+  )
+  {
+    dependencies.push_back(*(i + 1));
+  }
+
+  boost::filesystem::rename(tmp_pch, pch);
+
+  std::string deps_content;
+  for (const std::string& d : dependencies)
+  {
+    deps_content += describe_dependency(d);
+  }
+  const std::string tmp_deps = unique_name(deps);
+  write_file(tmp_deps, deps_content);
+  boost::filesystem::rename(tmp_deps, deps);
+
+  remove_least_recently_used();
+
+  return header;
+}
+
+bool pch_cache::up_to_date(const std::string& key_) const
+{
+  const std::string header = path_of(key_ + ".hpp");
+  if (
+    !boost::filesystem::exists(header)
+    || !boost::filesystem::exists(header + ".pch")
+  )
+  {
+    return false;
+  }
+
+  std::ifstream deps(path_of(key_ + deps_extension).c_str());
+  if (!deps)
+  {
+    return false;
+  }
+
+  for (std::string line; std::getline(deps, line);)
+  {
+    if (dependency_changed(line))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void pch_cache::remove_least_recently_used() const
+{
+  using boost::filesystem::directory_iterator;
+
+  if (_max_size == 0)
+  {
+    return;
+  }
+
+  const std::set<std::string> pinned = pinned_by_running_processes();
+
+  // (last use, key)
+  std::vector<std::pair<std::time_t, std::string>> entries;
+  std::uintmax_t total = 0;
+  boost::system::error_code ec;
+  for (directory_iterator i(_directory, ec), e; i != e; i.increment(ec))
+  {
+    const boost::filesystem::path& p = i->path();
+    if (p.extension() == deps_extension)
+    {
+      const std::string key = p.stem().string();
+      entries.push_back(
+        std::make_pair(boost::filesystem::last_write_time(p, ec), key)
+      );
+      total +=
+        size_of(p.string())
+        + size_of(path_of(key + ".hpp"))
+        + size_of(path_of(key + ".hpp.pch"));
+    }
+  }
+
+  std::sort(entries.begin(), entries.end());
+  for (
+    auto i = entries.begin();
+    i != entries.end() && total > _max_size;
+    ++i
+  )
+  {
+    if (pinned.find(i->second) != pinned.end())
+    {
+      continue;
+    }
+
+    const std::string deps = path_of(i->second + deps_extension);
+    const std::string header = path_of(i->second + ".hpp");
+
+    total -= size_of(deps) + size_of(header) + size_of(header + ".pch");
+
+    // The entry is invalid without the dependency list, so it is removed
+    // first.
+    remove_file(deps);
+    remove_file(header + ".pch");
+    remove_file(header);
+  }
+}
+
+std::string pch_cache::path_of(const std::string& filename_) const
+{
+  return (boost::filesystem::path(_directory) / filename_).string();
+}
+
+void pch_cache::pin(const std::string& key_)
+{
+  std::lock_guard<std::mutex> l(_pin_lock);
+  if (_pinned.insert(key_).second)
+  {
+    save_pins();
+  }
+}
+
+void pch_cache::save_pins()
+{
+  const std::string dir = path_of(pins_dir);
+  boost::filesystem::create_directories(dir);
+  if (_pin_file.empty())
+  {
+    _pin_file = (boost::filesystem::path(dir) / pin_filename()).string();
+  }
+
+  std::string content;
+  for (const std::string& key : _pinned)
+  {
+    content += key + "\n";
+  }
+  // Other shells see either the old or the new list
+  const std::string tmp = unique_name(_pin_file);
+  write_file(tmp, content);
+  boost::filesystem::rename(tmp, _pin_file);
+}
+
+std::set<std::string> pch_cache::pinned_by_running_processes() const
+{
+  using boost::filesystem::directory_iterator;
+
+  std::set<std::string> result;
+  boost::system::error_code ec;
+  for (
+    directory_iterator i(path_of(pins_dir), ec), e;
+    i != e;
+    i.increment(ec)
+  )
+  {
+    const boost::filesystem::path& p = i->path();
+    if (p.extension() != pin_extension)
+    {
+      // Nothing to do
+    }
+    else if (owner_running(p))
+    {
+      std::ifstream f(p.string().c_str());
+      for (std::string key; std::getline(f, key);)
+      {
+        result.insert(key);
+      }
+    }
+    else
+    {
+      // Left behind by a process that did not exit normally
+      remove_file(p.string());
+    }
+  }
+  return result;
+}
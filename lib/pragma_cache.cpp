@@ -0,0 +1,52 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/pragma_cache.hpp>
+#include <metashell/shell.hpp>
+
+#include <sstream>
+
+using namespace metashell;
+
+pragma_cache::pragma_cache(shell& shell_) :
+  pragma_without_arguments(shell_, "cache")
+{}
+
+pragma_handler_interface* pragma_cache::clone() const
+{
+  return new pragma_cache(get_shell());
+}
+
+std::string pragma_cache::description() const
+{
+  return
+    "Displays the statistics of the cache storing the results of the"
+    " evaluated metaprograms. Note that the cache does not notice when an"
+    " included header changes on the disk. Use #msh cache clear in that"
+    " case.";
+}
+
+void pragma_cache::run() const
+{
+  const evaluation_cache& c = get_shell().get_evaluation_cache();
+
+  std::ostringstream s;
+  s
+    << "// Evaluation cache: " << c.size() << " of " << c.max_size()
+    << " entries used, " << c.hits() << " hits, " << c.misses()
+    << " misses\n";
+  get_shell().display_normal(s.str());
+}
@@ -29,9 +29,13 @@
 #include <metashell/pragma_environment_add.hpp>
 #include <metashell/pragma_environment_reset.hpp>
 #include <metashell/pragma_environment_reload.hpp>
+#include <metashell/pragma_environment_check.hpp>
 #include <metashell/pragma_environment_save.hpp>
 #include <metashell/pragma_mdb.hpp>
 #include <metashell/pragma_evaluate.hpp>
+#include <metashell/pragma_cache.hpp>
+#include <metashell/pragma_cache_clear.hpp>
+#include <metashell/pragma_timing_totals.hpp>
 
 #include <cassert>
 #include <iostream>
@@ -170,9 +174,22 @@ pragma_handler_map pragma_handler_map::build_default(shell& shell_)
       .add("environment", "add", pragma_environment_add(shell_))
       .add("environment", "reset", pragma_environment_reset(shell_))
       .add("environment", "reload", pragma_environment_reload(shell_))
+      .add("environment", "check", pragma_environment_check(shell_))
       .add("environment", "save", pragma_environment_save(shell_))
       .add("mdb", pragma_mdb(shell_))
       .add("evaluate", pragma_evaluate(shell_))
+      .add("cache", pragma_cache(shell_))
+      .add("cache", "clear", pragma_cache_clear(shell_))
+      .add(
+        "timing",
+        pragma_switch(
+          "timing",
+          [&shell_] () { return shell_.timing_enabled(); },
+          [&shell_] (bool v_) { shell_.timing_enabled(v_); },
+          shell_
+        )
+      )
+      .add("timing", "totals", pragma_timing_totals(shell_))
       .add("quit", pragma_quit(shell_))
     ;
 }
@@ -0,0 +1,48 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/pragma_timing_totals.hpp>
+#include <metashell/shell.hpp>
+
+#include <sstream>
+
+using namespace metashell;
+
+pragma_timing_totals::pragma_timing_totals(shell& shell_) :
+  pragma_without_arguments(shell_, "timing totals")
+{}
+
+pragma_handler_interface* pragma_timing_totals::clone() const
+{
+  return new pragma_timing_totals(get_shell());
+}
+
+std::string pragma_timing_totals::description() const
+{
+  return
+    "Displays the time spent in the stages of evaluating the queries so far"
+    " and the largest amount of memory libclang used for them.";
+}
+
+void pragma_timing_totals::run() const
+{
+  const timing& t = get_shell().timing_totals();
+
+  std::ostringstream s;
+  s << "// Timing of " << t.queries() << " queries\n" << t.str();
+  get_shell().display_normal(s.str());
+}
+
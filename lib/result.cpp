@@ -18,7 +18,7 @@
 
 using namespace metashell;
 
-result::result() {}
+result::result() : resource_limit_exceeded(false) {}
 
 bool result::has_errors() const
 {
@@ -17,17 +17,19 @@
 #include <metashell/metashell.hpp>
 #include <metashell/wave_tokeniser.hpp>
 #include "indenter.hpp"
+#include "cxindex.hpp"
 
 #include <metashell/shell.hpp>
 #include <metashell/version.hpp>
 #include <metashell/in_memory_environment.hpp>
 #include <metashell/header_file_environment.hpp>
+#include <metashell/evaluator_pool.hpp>
 #include <metashell/metashell_pragma.hpp>
 #include <metashell/command.hpp>
-#include <metashell/to_string.hpp>
 #include <metashell/exception.hpp>
 
 #include <cctype>
+#include <thread>
 #include <algorithm>
 #include <iostream>
 #include <sstream>
@@ -87,57 +89,29 @@ namespace
         }
       ) == cmd_.end();
   }
-
-  const char default_env[] =
-    "#define __METASHELL\n"
-    "#define __METASHELL_MAJOR " TO_STRING(METASHELL_MAJOR) "\n"
-    "#define __METASHELL_MINOR " TO_STRING(METASHELL_MINOR) "\n"
-    "#define __METASHELL_PATCH " TO_STRING(METASHELL_PATCH) "\n"
-
-    "namespace metashell { "
-      "namespace impl { "
-        "template <class T> "
-        "struct wrap {}; "
-
-        "template <class T> "
-        "typename T::tag* tag_of(::metashell::impl::wrap<T>); "
-
-        "void* tag_of(...); "
-
-        "template <class T> "
-        "struct remove_ptr; "
-
-        "template <class T> "
-        "struct remove_ptr<T*> { typedef T type; }; "
-      "} "
-
-      "template <class Tag> "
-      "struct format_impl "
-      "{ "
-        "typedef format_impl type; "
-
-        "template <class T> "
-        "struct apply { typedef T type; }; "
-      "}; "
-
-      "template <class T> "
-      "struct format : "
-        "::metashell::format_impl<"
-          "typename ::metashell::impl::remove_ptr<"
-            "decltype(::metashell::impl::tag_of(::metashell::impl::wrap<T>()))"
-          ">::type"
-        ">::template apply<T>"
-        "{}; "
-
-      ""
-    "}"
-    "\n";
 }
 
 shell::shell(const config& config_) :
   _env(),
+  _index(new cxindex()),
+  _declaration_index(
+    new cxindex(
+      CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_Incomplete
+    )
+  ),
   _config(config_),
-  _stopped(false)
+  _stopped(false),
+  _evaluation_cache(config_.evaluation_cache_size),
+  _deferring_queries(false),
+  _deferred_queries(),
+  _worker_count(1),
+  _worker_indices(),
+  _evaluator_pool(
+    config_.evaluator_processes > 0 ? new evaluator_pool(config_) : 0
+  ),
+  _timing_enabled(false),
+  _timing_totals(),
+  _cancelled(false)
 {
   rebuild_environment();
   init();
@@ -145,15 +119,35 @@ shell::shell(const config& config_) :
 
 shell::shell(const config& config_, environment* env_) :
   _env(env_),
+  _index(new cxindex()),
+  _declaration_index(
+    new cxindex(
+      CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_Incomplete
+    )
+  ),
   _config(config_),
-  _stopped(false)
+  _stopped(false),
+  _evaluation_cache(config_.evaluation_cache_size),
+  _deferring_queries(false),
+  _deferred_queries(),
+  _worker_count(1),
+  _worker_indices(),
+  _evaluator_pool(
+    config_.evaluator_processes > 0 ? new evaluator_pool(config_) : 0
+  ),
+  _timing_enabled(false),
+  _timing_totals(),
+  _cancelled(false)
 {
   init();
 }
 
 shell::~shell() {}
 
-void shell::cancel_operation() {}
+void shell::cancel_operation()
+{
+  _cancelled = true;
+}
 
 void shell::display_splash() const
 {
@@ -251,12 +245,18 @@ void shell::line_available(const std::string& s_)
         {
           if (boost::optional<command::iterator> p = parse_pragma(cmd))
           {
+            run_deferred_queries();
             _pragma_handlers.process(*p, cmd.end());
           }
           else if (is_environment_setup_command(cmd))
           {
+            run_deferred_queries();
             store_in_buffer(s);
           }
+          else if (_deferring_queries)
+          {
+            _deferred_queries.push_back(s);
+          }
           else
           {
             run_metaprogram(s);
@@ -279,6 +279,44 @@ void shell::line_available(const std::string& s_)
   }
 }
 
+void shell::lines_available(
+  const std::vector<std::string>& lines_,
+  int worker_count_
+)
+{
+  _deferring_queries = true;
+  _worker_count = worker_count_;
+
+  for (const std::string& line : lines_)
+  {
+    if (stopped())
+    {
+      break;
+    }
+    line_available(line);
+  }
+
+  _deferring_queries = false;
+  try
+  {
+    run_deferred_queries();
+  }
+  catch (const std::exception& e)
+  {
+    display_error(std::string("Error: ") + e.what());
+  }
+}
+
+void shell::run_deferred_queries()
+{
+  if (!_deferred_queries.empty())
+  {
+    std::vector<std::string> queries;
+    queries.swap(_deferred_queries);
+    run_metaprograms(queries, _worker_count);
+  }
+}
+
 std::string shell::prompt() const
 {
   return _line_prefix.empty() ? "> " : "...> ";
@@ -286,7 +324,42 @@ std::string shell::prompt() const
 
 bool shell::store_in_buffer(const std::string& s_)
 {
-  const result r = validate_code(s_, _config, *_env, input_filename());
+  const bool declarations_only = _config.validate_declarations_only;
+  const boost::optional<result>
+    validated =
+      run_cancellable(
+        [this, &s_, declarations_only]
+        (evaluator_pool& pool_, const std::atomic<bool>* cancelled_)
+        {
+          return
+            pool_.validate_code(
+              s_,
+              _config,
+              *_env,
+              input_filename(),
+              declarations_only,
+              cancelled_
+            );
+        },
+        [this, &s_, declarations_only]
+        {
+          return
+            validate_code(
+              declarations_only ? *_declaration_index : *_index,
+              s_,
+              _config,
+              *_env,
+              input_filename()
+            );
+        }
+      );
+  if (!validated)
+  {
+    display_error("Cancelled");
+    return false;
+  }
+
+  const result& r = *validated;
   const bool success = !r.has_errors();
   if (success)
   {
@@ -304,22 +377,79 @@ bool shell::store_in_buffer(const std::string& s_)
   return success;
 }
 
+void shell::check_environment()
+{
+  const boost::optional<result>
+    r =
+      run_cancellable(
+        [this](evaluator_pool& pool_, const std::atomic<bool>* cancelled_)
+        {
+          return
+            pool_.validate_code(
+              "",
+              _config,
+              *_env,
+              input_filename(),
+              false,
+              cancelled_
+            );
+        },
+        [this]
+        {
+          return validate_code(*_index, "", _config, *_env, input_filename());
+        }
+      );
+  if (!r)
+  {
+    display_error("Cancelled");
+  }
+  else if (r->has_errors())
+  {
+    ::display(*r, *this);
+  }
+  else
+  {
+    display_normal("// The environment is valid\n");
+  }
+}
+
 const char* shell::input_filename()
 {
   return "<stdin>";
 }
 
+result shell::validate(const std::string& s_) const
+{
+  if (_evaluator_pool)
+  {
+    // It is not cancellable, therefore it always returns a result
+    return
+      *_evaluator_pool->validate_code(s_, _config, *_env, input_filename());
+  }
+  else
+  {
+    return validate_code(*_index, s_, _config, *_env, input_filename());
+  }
+}
+
 void shell::code_complete(
   const std::string& s_,
   std::set<std::string>& out_
 ) const
 {
-  metashell::code_complete(*_env, s_, input_filename(), out_);
+  if (_evaluator_pool)
+  {
+    _evaluator_pool->code_complete(*_env, s_, input_filename(), out_);
+  }
+  else
+  {
+    metashell::code_complete(*_index, *_env, s_, input_filename(), out_);
+  }
 }
 
 void shell::init()
 {
-  _env->append(default_env);
+  _env->append(default_environment());
 
   // TODO: move it to initialisation later
   _pragma_handlers = pragma_handler_map::build_default(*this);
@@ -366,30 +496,53 @@ const environment& shell::env() const
   return *_env;
 }
 
-void shell::rebuild_environment(const std::string& content_)
+std::unique_ptr<environment> shell::create_environment(
+  const std::string& content_
+) const
 {
+  std::unique_ptr<environment> e;
   if (_config.use_precompiled_headers)
   {
-    _env.reset(new header_file_environment(_config));
+    e.reset(new header_file_environment(_config));
   }
   else
   {
-    _env.reset(new in_memory_environment("__metashell_internal", _config));
+    e.reset(new in_memory_environment("__metashell_internal", _config));
   }
   if (!content_.empty())
   {
-    _env->append(content_);
+    e->append(content_);
   }
+  return e;
+}
+
+void shell::rebuild_environment(const std::string& content_)
+{
+  _env = create_environment(content_);
 }
 
 void shell::rebuild_environment()
 {
+  // The environments on the stack are rebuilt as well to use the current
+  // settings after popping them.
+  std::vector<std::string> stack;
+  for (; !_environment_stack.empty(); _environment_stack.pop())
+  {
+    stack.push_back(_environment_stack.top()->get_all());
+  }
+  for (auto i = stack.rbegin(), e = stack.rend(); i != e; ++i)
+  {
+    _environment_stack.push(create_environment(*i));
+  }
+
   rebuild_environment(_env ? _env->get_all() : std::string());
 }
 
 void shell::push_environment()
 {
-  _environment_stack.push(_env->get_all());
+  std::unique_ptr<environment> child = _env->create_child();
+  _environment_stack.push(std::move(_env));
+  _env = std::move(child);
 }
 
 void shell::pop_environment()
@@ -400,7 +553,7 @@ void shell::pop_environment()
   }
   else
   {
-    rebuild_environment(_environment_stack.top());
+    _env = std::move(_environment_stack.top());
     _environment_stack.pop();
   }
 }
@@ -427,13 +580,298 @@ void shell::display_environment_stack_size()
 
 void shell::run_metaprogram(const std::string& s_)
 {
-  display(eval_tmp_formatted(*_env, s_, _config, input_filename()), *this);
+  timing t;
+  t.count_query();
+  {
+    timing_recorder recorder(t);
+
+    // Picking up the finished precompiled headers changes what the cache
+    // key is computed from
+    _env->refresh();
+
+    boost::optional<result> r;
+    {
+      timed_stage cache_lookup("cache lookup");
+      r = _evaluation_cache.find(*_env, _config, s_);
+    }
+
+    if (!r)
+    {
+      r =
+        run_cancellable(
+          [this, &s_](evaluator_pool& pool_, const std::atomic<bool>* c_)
+          {
+            return
+              pool_.eval_tmp_formatted(
+                *_env,
+                s_,
+                _config,
+                input_filename(),
+                c_
+              );
+          },
+          [this, &s_]
+          {
+            return
+              eval_tmp_formatted(
+                *_index,
+                *_env,
+                s_,
+                _config,
+                input_filename()
+              );
+          }
+        );
+      if (!r)
+      {
+        display_error("Cancelled");
+        return;
+      }
+
+      if (!r->resource_limit_exceeded)
+      {
+        _evaluation_cache.add(*_env, _config, s_, *r);
+      }
+    }
+
+    timed_stage display_stage("display");
+    display(*r, *this);
+  }
+
+  _timing_totals.add(t);
+  if (_timing_enabled)
+  {
+    display_normal(t.str());
+  }
+}
+
+boost::optional<result> shell::run_cancellable(
+  const std::function<
+    boost::optional<result> (evaluator_pool&, const std::atomic<bool>*)
+  >& in_pool_,
+  const std::function<result ()>& in_shell_
+)
+{
+  _cancelled = false;
+  _env->refresh();
+  if (_evaluator_pool)
+  {
+    return in_pool_(*_evaluator_pool, &_cancelled);
+  }
+  else
+  {
+    return in_shell_();
+  }
+}
+
+void shell::run_metaprograms(const std::vector<std::string>& s_)
+{
+  run_metaprograms(s_, 1);
+}
+
+void shell::run_metaprograms(
+  const std::vector<std::string>& s_,
+  int worker_count_
+)
+{
+  std::vector<boost::optional<result>> results;
+  results.reserve(s_.size());
+
+  _env->refresh();
+
+  std::vector<std::string> to_evaluate;
+  for (const std::string& s : s_)
+  {
+    results.push_back(_evaluation_cache.find(*_env, _config, s));
+    if (!results.back())
+    {
+      to_evaluate.push_back(s);
+    }
+  }
+
+  if (!to_evaluate.empty())
+  {
+    std::vector<bool> failed;
+    const std::vector<result>
+      evaluated = eval_in_parallel(to_evaluate, worker_count_, failed);
+
+    std::vector<result>::size_type e = 0;
+    for (std::vector<result>::size_type i = 0; i != results.size(); ++i)
+    {
+      if (!results[i])
+      {
+        results[i] = evaluated[e];
+        // The same query may succeed next time
+        if (!failed[e] && !evaluated[e].resource_limit_exceeded)
+        {
+          _evaluation_cache.add(*_env, _config, s_[i], evaluated[e]);
+        }
+        ++e;
+      }
+    }
+  }
+
+  for (const boost::optional<result>& r : results)
+  {
+    display(*r, *this);
+  }
+}
+
+std::vector<result> shell::eval_in_parallel(
+  const std::vector<std::string>& s_,
+  int worker_count_,
+  std::vector<bool>& failed_
+)
+{
+  const int n = s_.size();
+  const int workers = std::max(1, std::min(worker_count_, n));
+
+  // With one worker the exceptions are propagated to the caller
+  failed_.assign(n, false);
+
+  // The workers share the environment, it must not change while they run
+  _env->refresh();
+
+  // The evaluations are not cancellable, therefore the pool always
+  // returns the results
+  if (workers == 1 && _evaluator_pool)
+  {
+    return
+      *_evaluator_pool->eval_tmp_formatted(
+        *_env,
+        s_,
+        _config,
+        input_filename()
+      );
+  }
+  else if (workers == 1)
+  {
+    return eval_tmp_formatted(*_index, *_env, s_, _config, input_filename());
+  }
+  else
+  {
+    if (_evaluator_pool)
+    {
+      // The workers started for the threads are kept for the next batch
+      _evaluator_pool->reserve(workers);
+    }
+    while (
+      !_evaluator_pool
+      && _worker_indices.size() < std::vector<cxindex>::size_type(workers)
+    )
+    {
+      _worker_indices.push_back(std::unique_ptr<cxindex>(new cxindex()));
+    }
+
+    // Each worker evaluates a continuous range of the queries in one
+    // translation unit. The environment is not changed while they are
+    // running.
+    std::vector<std::vector<result>> worker_results(workers);
+    // Not std::vector<bool>, the threads set different elements of it
+    std::vector<char> worker_failed(workers, false);
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (int w = 0; w != workers; ++w)
+    {
+      threads.push_back(
+        std::thread(
+          [this, &s_, &worker_results, &worker_failed, w, workers, n]
+          {
+            const std::vector<std::string>
+              queries(
+                s_.begin() + n * w / workers,
+                s_.begin() + n * (w + 1) / workers
+              );
+            try
+            {
+              worker_results[w] =
+                this->_evaluator_pool ?
+                  *this->_evaluator_pool->eval_tmp_formatted(
+                    *this->_env,
+                    queries,
+                    this->_config,
+                    input_filename()
+                  ) :
+                  eval_tmp_formatted(
+                    *this->_worker_indices[w],
+                    *this->_env,
+                    queries,
+                    this->_config,
+                    input_filename()
+                  );
+            }
+            catch (const std::exception& e)
+            {
+              worker_failed[w] = true;
+              const std::string es[] = { e.what() };
+              worker_results[w].assign(
+                queries.size(),
+                result("", es, es + sizeof(es) / sizeof(es[0]), "")
+              );
+            }
+            catch (...)
+            {
+              worker_failed[w] = true;
+              const std::string es[] = { "Unknown error" };
+              worker_results[w].assign(
+                queries.size(),
+                result("", es, es + sizeof(es) / sizeof(es[0]), "")
+              );
+            }
+          }
+        )
+      );
+    }
+
+    std::vector<result> results;
+    results.reserve(n);
+    for (int w = 0; w != workers; ++w)
+    {
+      threads[w].join();
+      std::fill(
+        failed_.begin() + results.size(),
+        failed_.begin() + results.size() + worker_results[w].size(),
+        bool(worker_failed[w])
+      );
+      results.insert(
+        results.end(),
+        worker_results[w].begin(),
+        worker_results[w].end()
+      );
+    }
+    return results;
+  }
 }
 
 void shell::reset_environment()
 {
   rebuild_environment("");
-  _env->append(default_env);
+  _env->append(default_environment());
+}
+
+const evaluation_cache& shell::get_evaluation_cache() const
+{
+  return _evaluation_cache;
+}
+
+void shell::clear_evaluation_cache()
+{
+  _evaluation_cache.clear();
+}
+
+void shell::timing_enabled(bool enabled_)
+{
+  _timing_enabled = enabled_;
+}
+
+bool shell::timing_enabled() const
+{
+  return _timing_enabled;
+}
+
+const timing& shell::timing_totals() const
+{
+  return _timing_totals;
 }
 
 const config& shell::get_config() const {
@@ -0,0 +1,105 @@
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/string_pool.hpp>
+#include <metashell/exception.hpp>
+
+#include <cassert>
+
+namespace metashell {
+
+const string_index::id_type string_index::empty_slot;
+
+string_index::string_index() : count(0) {}
+
+void string_index::insert(boost::string_ref key, id_type id) {
+  assert(id != empty_slot);
+
+  // Keep the load factor at most 1/2
+  if ((count + 1) * 2 > slots.size()) {
+    grow();
+  }
+  insert_slot(slot{hash(key), id});
+  ++count;
+}
+
+std::size_t string_index::size() const {
+  return count;
+}
+
+std::uint32_t string_index::hash(boost::string_ref key) {
+  // FNV-1a
+  std::uint32_t h = 2166136261u;
+  for (char c : key) {
+    h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+  }
+  return h;
+}
+
+void string_index::grow() {
+  std::vector<slot> old_slots(
+      slots.empty() ? 16 : slots.size() * 2, slot{0, empty_slot});
+  old_slots.swap(slots);
+
+  for (const slot& s : old_slots) {
+    if (s.id != empty_slot) {
+      insert_slot(s);
+    }
+  }
+}
+
+void string_index::insert_slot(const slot& s) {
+  const std::size_t mask = slots.size() - 1;
+  std::size_t i = s.hash & mask;
+  while (slots[i].id != empty_slot) {
+    i = (i + 1) & mask;
+  }
+  slots[i] = s;
+}
+
+string_pool::id_type string_pool::intern(boost::string_ref s) {
+  if (const boost::optional<id_type> id = find(s)) {
+    return *id;
+  }
+  if (strings.size() >= string_index::empty_slot) {
+    throw exception("Too many strings in the string pool");
+  }
+  const id_type id = strings.size();
+  strings.push_back(std::string(s.begin(), s.end()));
+  index.insert(s, id);
+  return id;
+}
+
+boost::optional<string_pool::id_type> string_pool::find(
+    boost::string_ref s) const
+{
+  return
+    index.find(s, [this](id_type id) -> const std::string& {
+      return strings[id];
+    });
+}
+
+const std::string& string_pool::operator[](id_type id) const {
+  assert(id < strings.size());
+  return strings[id];
+}
+
+std::size_t string_pool::size() const {
+  return strings.size();
+}
+
+}
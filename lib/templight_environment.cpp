@@ -16,6 +16,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <metashell/templight_environment.hpp>
+#include <metashell/config.hpp>
 
 namespace metashell {
 
@@ -25,15 +26,22 @@ templight_environment::templight_environment(
 ) : in_memory_environment(internal_dir, config)
 {
   clang_arguments().push_back("-templight");
+  if (config.templight_memory) {
+    // Record the memory usage for the profile command
+    clang_arguments().push_back("-templight-memory");
+  }
   clang_arguments().push_back("-templight-format");
-  clang_arguments().push_back("xml");
+  clang_arguments().push_back(
+      templight_argument(config.templight_trace_format));
   clang_arguments().push_back("-templight-output");
-  clang_arguments().push_back("TEMPLIGHT_XML_LOCATION_IS_NOT_SET");
-  xml_path_index = clang_arguments().size() - 1;
+  clang_arguments().push_back("TEMPLIGHT_TRACE_LOCATION_IS_NOT_SET");
+  trace_path_index = clang_arguments().size() - 1;
 }
 
-void templight_environment::set_xml_location(const std::string& xml_location) {
-  clang_arguments()[xml_path_index] = xml_location;
+void templight_environment::set_trace_location(
+    const std::string& trace_location)
+{
+  clang_arguments()[trace_path_index] = trace_location;
 }
 
 }
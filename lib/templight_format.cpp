@@ -0,0 +1,50 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/templight_format.hpp>
+
+#include <stdexcept>
+
+using namespace metashell;
+
+templight_format::type metashell::parse_templight_format(
+  const std::string& format_
+)
+{
+  if (format_ == "xml")
+  {
+    return templight_format::xml;
+  }
+  else if (format_ == "binary")
+  {
+    return templight_format::binary;
+  }
+  else
+  {
+    throw std::runtime_error("Invalid templight format: " + format_);
+  }
+}
+
+std::string metashell::templight_argument(templight_format::type format_)
+{
+  switch (format_)
+  {
+  case templight_format::xml: return "xml";
+  case templight_format::binary: return "binary";
+  }
+  throw std::runtime_error("Invalid templight format value");
+}
+
@@ -0,0 +1,161 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/timing.hpp>
+
+#include <boost/thread/tss.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+using namespace metashell;
+
+namespace
+{
+  // The timing is not owned by the thread
+  void no_cleanup(timing*) {}
+
+  boost::thread_specific_ptr<timing> current_timing(no_cleanup);
+
+  template <class T>
+  typename std::vector<std::pair<std::string, T> >::iterator find_by_name(
+    std::vector<std::pair<std::string, T> >& v_,
+    const std::string& name_
+  )
+  {
+    return
+      std::find_if(
+        v_.begin(),
+        v_.end(),
+        [&name_](const std::pair<std::string, T>& p_)
+        {
+          return p_.first == name_;
+        }
+      );
+  }
+}
+
+timing::timing() : _queries(0) {}
+
+void timing::add_stage(const std::string& name_, double ms_)
+{
+  const stages::iterator i = find_by_name(_stages, name_);
+  if (i == _stages.end())
+  {
+    _stages.push_back(std::make_pair(name_, ms_));
+  }
+  else
+  {
+    i->second += ms_;
+  }
+}
+
+void timing::add_resource_usage(const std::string& name_, unsigned long bytes_)
+{
+  const resources::iterator i = find_by_name(_resources, name_);
+  if (i == _resources.end())
+  {
+    _resources.push_back(std::make_pair(name_, bytes_));
+  }
+  else
+  {
+    i->second = std::max(i->second, bytes_);
+  }
+}
+
+void timing::add(const timing& t_)
+{
+  for (const std::pair<std::string, double>& s : t_._stages)
+  {
+    add_stage(s.first, s.second);
+  }
+  for (const std::pair<std::string, unsigned long>& r : t_._resources)
+  {
+    add_resource_usage(r.first, r.second);
+  }
+  _queries += t_._queries;
+}
+
+void timing::count_query()
+{
+  ++_queries;
+}
+
+const timing::stages& timing::get_stages() const
+{
+  return _stages;
+}
+
+const timing::resources& timing::get_resources() const
+{
+  return _resources;
+}
+
+int timing::queries() const
+{
+  return _queries;
+}
+
+std::string timing::str() const
+{
+  std::ostringstream s;
+  s << std::fixed << std::setprecision(3);
+  for (const std::pair<std::string, double>& st : _stages)
+  {
+    s << "// " << st.first << ": " << st.second << " ms\n";
+  }
+  for (const std::pair<std::string, unsigned long>& r : _resources)
+  {
+    s << "// " << r.first << ": " << r.second << " bytes\n";
+  }
+  return s.str();
+}
+
+timed_stage::timed_stage(const char* name_) :
+  _name(name_),
+  _start(std::chrono::steady_clock::now())
+{}
+
+timed_stage::~timed_stage()
+{
+  if (timing* t = timing_recorder::current())
+  {
+    t->add_stage(
+      _name,
+      std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - _start
+      ).count()
+    );
+  }
+}
+
+timing_recorder::timing_recorder(timing& timing_) :
+  _prev(current_timing.get())
+{
+  current_timing.reset(&timing_);
+}
+
+timing_recorder::~timing_recorder()
+{
+  current_timing.reset(_prev);
+}
+
+timing* timing_recorder::current()
+{
+  return current_timing.get();
+}
+
@@ -12,6 +12,18 @@ user_config::user_config() :
   use_precompiled_headers(false),
   clang_path(),
   max_template_depth(256),
-  saving_enabled(false)
+  saving_enabled(false),
+  evaluation_cache_size(1024),
+  evaluator_processes(1),
+  evaluator_memory_limit_mb(0),
+  evaluator_timeout_sec(0),
+  evaluator_queries_per_process(0),
+  validate_declarations_only(false),
+  pch_cache_dir(),
+  pch_cache_size_mb(1024),
+  precompile_in_process(false),
+  redetect(false),
+  templight_trace_format(templight_format::xml),
+  templight_memory(false)
 {}
 
@@ -47,6 +47,9 @@
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+// BEGIN TEMPLIGHT
+#include "llvm/ADT/StringMap.h"
+// END TEMPLIGHT
 #include "llvm/ADT/TinyPtrVector.h"
 #include <deque>
 #include <memory>
@@ -8593,7 +8596,7 @@ public:
     uintptr_t Entity;
     SourceLocation PointOfInstantiation;
     double TimeStamp;
-    int MemoryUsage;
+    uint64_t MemoryUsage;
   };
 
   struct PrintableTraceEntry {
@@ -8604,7 +8607,7 @@ public:
     int Line = 0;
     int Column = 0;
     double TimeStamp = 0.0;
-    int MemoryUsage = 0;
+    uint64_t MemoryUsage = 0;
   };
 
   class TracePrinter {
@@ -8649,6 +8652,22 @@ public:
     std::string getFormatName() { return "text"; }
   };
 
+  /// \brief Length-prefixed binary events, the strings are written only
+  /// once and are referred to by their index later.
+  class BinaryPrinter : public TracePrinter {
+  public:
+    void startTrace(raw_ostream* os);
+    void endTrace(raw_ostream* os);
+    void printEntry(raw_ostream* os, const PrintableTraceEntry& Entry);
+
+    std::string getFormatName() { return "binary"; }
+
+  private:
+    void writeString(std::string& Out, const std::string& S);
+
+    llvm::StringMap<unsigned> StringIds;
+  };
+
 private:
   PrintableTraceEntry rawToPrintable(const RawTraceEntry& Entry);
 
@@ -25,6 +25,7 @@
 #include "clang/Sema/TemplateDeduction.h"
 
 // BEGIN TEMPLIGHT
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -147,17 +148,17 @@ void Sema::TextPrinter::printEntry(raw_ostream* os,
 
     *os << llvm::format(
       "  TimeStamp = %f\n"
-      "  MemoryUsage = %d\n"
-      , Entry.TimeStamp, Entry.MemoryUsage);
+      "  MemoryUsage = %llu\n"
+      , Entry.TimeStamp, (unsigned long long)Entry.MemoryUsage);
   } else {
     *os
       << llvm::format(
         "TemplateEnd\n"
         "  Kind = %s\n"
         "  TimeStamp = %f\n"
-        "  MemoryUsage = %d\n"
+        "  MemoryUsage = %llu\n"
         , Entry.InstantiationKind.c_str(),
-        Entry.TimeStamp, Entry.MemoryUsage);
+        Entry.TimeStamp, (unsigned long long)Entry.MemoryUsage);
   }
 }
 
@@ -244,19 +245,101 @@ void Sema::XmlPrinter::printEntry(
         Entry.FileName.c_str(), Entry.Line, Entry.Column);
 
     *os << llvm::format("    <TimeStamp time = \"%f\"/>\n"
-      "    <MemoryUsage bytes = \"%d\"/>\n"
-      "</TemplateBegin>\n", Entry.TimeStamp, Entry.MemoryUsage);
+      "    <MemoryUsage bytes = \"%llu\"/>\n"
+      "</TemplateBegin>\n", Entry.TimeStamp,
+      (unsigned long long)Entry.MemoryUsage);
   } else {
     *os
       << llvm::format("<TemplateEnd>\n"
         "    <Kind>%s</Kind>\n"
         "    <TimeStamp time = \"%f\"/>\n"
-        "    <MemoryUsage bytes = \"%d\"/>\n"
+        "    <MemoryUsage bytes = \"%llu\"/>\n"
         "</TemplateEnd>\n", Entry.InstantiationKind.c_str(),
-        Entry.TimeStamp, Entry.MemoryUsage);
+        Entry.TimeStamp, (unsigned long long)Entry.MemoryUsage);
   }
 }
 
+namespace { // unnamed namespace
+
+// The binary trace is little endian regardless of the host
+void appendInteger(std::string& Out, uint64_t Value, unsigned Bytes) {
+  for (unsigned i = 0; i < Bytes; ++i) {
+    Out += static_cast<char>((Value >> (8 * i)) & 0xFF);
+  }
+}
+
+unsigned instantiationKindIndex(const std::string& Kind) {
+  const unsigned KindCount =
+    sizeof(InstantiationKindStrings) / sizeof(InstantiationKindStrings[0]);
+  for (unsigned i = 0; i < KindCount; ++i) {
+    if (Kind == InstantiationKindStrings[i]) {
+      return i;
+    }
+  }
+  llvm_unreachable("Invalid InstantiationKind!");
+}
+
+} // unnamed namespace
+
+// Layout of the binary trace (every integer is little endian):
+//   header:  "TLBT" <version: u32 = 1>
+//   entry:   <payload length: u32> <payload>
+//   payload: <is template begin: u8> <kind: u8> <timestamp: f64>
+//            <memory usage: u64>
+//            and for template begins: <name: string> <file name: string>
+//            <line: u32> <column: u32>
+//   string:  <id: u32>, when the id is the number of strings written so far
+//            it is followed by <length: u32> <bytes> defining that string
+// Readers have to ignore the extra bytes at the end of the payload.
+void Sema::BinaryPrinter::startTrace(raw_ostream* os) {
+  std::string Header("TLBT");
+  appendInteger(Header, 1, 4);
+  *os << Header;
+}
+
+void Sema::BinaryPrinter::endTrace(raw_ostream*) {
+}
+
+void Sema::BinaryPrinter::writeString(std::string& Out, const std::string& S) {
+  llvm::StringMap<unsigned>::iterator It = StringIds.find(S);
+  if (It != StringIds.end()) {
+    appendInteger(Out, It->getValue(), 4);
+  } else {
+    const unsigned Id = StringIds.size();
+    StringIds[S] = Id;
+    appendInteger(Out, Id, 4);
+    appendInteger(Out, S.size(), 4);
+    Out += S;
+  }
+}
+
+void Sema::BinaryPrinter::printEntry(raw_ostream* os,
+  const PrintableTraceEntry& Entry) {
+  std::string Payload;
+  Payload.reserve(64);
+
+  uint64_t TimeStampBits;
+  static_assert(sizeof(TimeStampBits) == sizeof(Entry.TimeStamp),
+    "The timestamp is written as a 64 bit double");
+  std::memcpy(&TimeStampBits, &Entry.TimeStamp, sizeof(TimeStampBits));
+
+  appendInteger(Payload, Entry.IsTemplateBegin ? 1 : 0, 1);
+  appendInteger(Payload, instantiationKindIndex(Entry.InstantiationKind), 1);
+  appendInteger(Payload, TimeStampBits, 8);
+  appendInteger(Payload, Entry.MemoryUsage, 8);
+
+  if (Entry.IsTemplateBegin) {
+    writeString(Payload, Entry.Name);
+    writeString(Payload, Entry.FileName);
+    appendInteger(Payload, Entry.Line, 4);
+    appendInteger(Payload, Entry.Column, 4);
+  }
+
+  std::string Length;
+  appendInteger(Length, Payload.size(), 4);
+  *os << Length << Payload;
+}
+
 void Sema::setTemplightFormat(const std::string& Format) {
   if (Format == "yaml") {
     TemplateTracePrinter.reset(new YamlPrinter());
@@ -267,6 +350,9 @@ void Sema::setTemplightFormat(const std::string& Format) {
   else if (Format == "txt") {
     TemplateTracePrinter.reset(new TextPrinter());
   }
+  else if (Format == "binary") {
+    TemplateTracePrinter.reset(new BinaryPrinter());
+  }
   else {
     llvm::errs() << "Error: Unrecoginized template trace format:" << Format << '\n';
   }
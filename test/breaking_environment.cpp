@@ -69,6 +69,12 @@ std::string breaking_environment::get_appended(const std::string& s_) const
   return in_memory_environment::get_appended(s_);
 }
 
+std::vector<boost::string_ref> breaking_environment::get_parts() const
+{
+  throw_(!_in_append && _get_appended_throw);
+  return in_memory_environment::get_parts();
+}
+
 void breaking_environment::append_throw_from_now()
 {
   assert(!_append_throw);
@@ -26,8 +26,10 @@ public:
 
   virtual void append(const std::string& s_);
   virtual std::string get_appended(const std::string& s_) const;
+  virtual std::vector<boost::string_ref> get_parts() const;
 
   void append_throw_from_now();
+  // get_parts throws as well, since the code is passed to clang by that
   void get_appended_throw_from_now();
 private:
   bool _append_throw;
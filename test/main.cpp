@@ -16,10 +16,20 @@
 
 #include "argv0.hpp"
 
+#include <metashell/evaluator_pool.hpp>
+
 #include <just/test.hpp>
 
 int main(int argc_, char* argv_[])
 {
+  // The evaluator processes of the tests run this executable
+  const boost::optional<int>
+    worker_exit_code = metashell::evaluator_pool::run_worker(argc_, argv_);
+  if (worker_exit_code)
+  {
+    return *worker_exit_code;
+  }
+
   argv0::set(argv_[0]);
   return ::just::test::run(argc_, argv_);
 }
@@ -79,6 +79,26 @@ JUST_TEST_CASE(test_template_depth_parsing)
   JUST_ASSERT_EQUAL(13, cfg.max_template_depth);
 }
 
+JUST_TEST_CASE(test_evaluate_all_parsing)
+{
+  const char* args[] = {"metashell", "--evaluate_all", "queries.txt"};
+
+  const metashell::parse_config_result r = parse_config(args);
+
+  JUST_ASSERT(r.should_evaluate_all());
+  JUST_ASSERT(!r.should_run_shell());
+  JUST_ASSERT_EQUAL("queries.txt", r.evaluate_all_file);
+}
+
+JUST_TEST_CASE(test_evaluation_cache_size_parsing)
+{
+  const char* args[] = {"metashell", "--evaluation_cache_size", "13"};
+
+  const metashell::user_config cfg = parse_config(args).cfg;
+
+  JUST_ASSERT_EQUAL(13, cfg.evaluation_cache_size);
+}
+
 JUST_TEST_CASE(test_negative_template_depth_is_an_error)
 {
   const char* args[] = {"metashell", "-ftemplate-depth=-1"};
@@ -168,3 +188,127 @@ JUST_TEST_CASE(test_enabling_saving)
   JUST_ASSERT(r.cfg.saving_enabled);
 }
 
+
+JUST_TEST_CASE(test_batch_parsing)
+{
+  const char* args[] = {"metashell", "--batch", "-", "-j", "4"};
+
+  const metashell::parse_config_result r = parse_config(args);
+
+  JUST_ASSERT(r.should_run_batch());
+  JUST_ASSERT(!r.should_run_shell());
+  JUST_ASSERT_EQUAL("-", r.batch_file);
+  JUST_ASSERT_EQUAL(4, r.jobs);
+}
+
+JUST_TEST_CASE(test_evaluator_process_options_parsing)
+{
+  const char* args[] =
+    {
+      "metashell",
+      "--evaluator_processes", "2",
+      "--evaluator_memory_limit", "512",
+      "--evaluator_timeout", "10",
+      "--evaluator_queries_per_process", "100"
+    };
+
+  const metashell::user_config cfg = parse_config(args).cfg;
+
+  JUST_ASSERT_EQUAL(2, cfg.evaluator_processes);
+  JUST_ASSERT_EQUAL(512, cfg.evaluator_memory_limit_mb);
+  JUST_ASSERT_EQUAL(10, cfg.evaluator_timeout_sec);
+  JUST_ASSERT_EQUAL(100, cfg.evaluator_queries_per_process);
+}
+
+JUST_TEST_CASE(test_pch_cache_options_parsing)
+{
+  const char* args[] =
+    {
+      "metashell",
+      "--pch_cache_dir", "/tmp/pch",
+      "--pch_cache_size", "64"
+    };
+
+  const metashell::user_config cfg = parse_config(args).cfg;
+
+  JUST_ASSERT_EQUAL("/tmp/pch", cfg.pch_cache_dir);
+  JUST_ASSERT_EQUAL(64, cfg.pch_cache_size_mb);
+}
+
+JUST_TEST_CASE(test_precompile_in_process_parsing)
+{
+  const char* args[] = {"metashell", "--precompile_in_process"};
+
+  JUST_ASSERT(parse_config(args).cfg.precompile_in_process);
+}
+
+JUST_TEST_CASE(test_build_default_pch_parsing)
+{
+  const char* args[] = {"metashell", "--build_default_pch", "/tmp/pch"};
+
+  const metashell::parse_config_result r = parse_config(args);
+
+  JUST_ASSERT(r.should_build_default_pch());
+  JUST_ASSERT(!r.should_run_shell());
+  JUST_ASSERT_EQUAL("/tmp/pch", r.default_pch_dir);
+}
+
+JUST_TEST_CASE(test_redetect_parsing)
+{
+  const char* args[] = {"metashell", "--redetect"};
+
+  JUST_ASSERT(parse_config(args).cfg.redetect);
+}
+
+JUST_TEST_CASE(test_validate_declarations_only_parsing)
+{
+  const char* args[] = {"metashell", "--validate_declarations_only"};
+
+  JUST_ASSERT(parse_config(args).cfg.validate_declarations_only);
+}
+
+JUST_TEST_CASE(test_default_templight_format)
+{
+  const char* args[] = {"metashell"};
+
+  JUST_ASSERT_EQUAL(
+    metashell::templight_format::xml,
+    parse_config(args).cfg.templight_trace_format
+  );
+}
+
+JUST_TEST_CASE(test_templight_format_parsing)
+{
+  const char* args[] = {"metashell", "--templight_format", "binary"};
+
+  JUST_ASSERT_EQUAL(
+    metashell::templight_format::binary,
+    parse_config(args).cfg.templight_trace_format
+  );
+}
+
+JUST_TEST_CASE(test_templight_memory_is_not_recorded_by_default)
+{
+  const char* args[] = {"metashell"};
+
+  JUST_ASSERT(!parse_config(args).cfg.templight_memory);
+}
+
+JUST_TEST_CASE(test_templight_memory_parsing)
+{
+  const char* args[] = {"metashell", "--templight_memory"};
+
+  JUST_ASSERT(parse_config(args).cfg.templight_memory);
+}
+
+JUST_TEST_CASE(test_invalid_templight_format_is_an_error)
+{
+  const char* args[] = {"metashell", "--templight_format", "yaml"};
+
+  std::ostringstream err;
+  const metashell::parse_config_result r = parse_config(args, nullptr, &err);
+
+  JUST_ASSERT(!r.should_run_shell());
+  JUST_ASSERT(r.should_error_at_exit());
+  JUST_ASSERT_EQUAL("Invalid templight format: yaml", first_line_of(err));
+}
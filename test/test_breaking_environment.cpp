@@ -30,6 +30,7 @@ JUST_TEST_CASE(test_breaking_environment_does_not_throw)
   e.append("foo");
   e.get();
   e.get_appended("bar");
+  e.get_parts();
   e.internal_dir();
   e.clang_arguments();
   e.get_headers();
@@ -44,6 +45,7 @@ JUST_TEST_CASE(test_breaking_environment_append_throws)
   JUST_ASSERT_THROWS_SOMETHING(e.append("foo"));
   e.get();
   e.get_appended("bar");
+  e.get_parts();
   e.internal_dir();
   e.clang_arguments();
   e.get_headers();
@@ -58,6 +60,7 @@ JUST_TEST_CASE(test_breaking_environment_get_appended_throws)
   e.append("foo");
   e.get();
   JUST_ASSERT_THROWS_SOMETHING(e.get_appended("bar"));
+  JUST_ASSERT_THROWS_SOMETHING(e.get_parts());
   e.internal_dir();
   e.clang_arguments();
   e.get_headers();
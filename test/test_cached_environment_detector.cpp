@@ -0,0 +1,112 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mock_environment_detector.hpp"
+
+#include <metashell/cached_environment_detector.hpp>
+#include <metashell/config.hpp>
+
+#include <just/test.hpp>
+#include <just/temp.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace metashell;
+
+JUST_TEST_CASE(test_cached_sysinclude_is_not_detected_again)
+{
+  just::temp::directory d;
+  const std::string cache_file = d.path() + "/cache";
+
+  mock_environment_detector envd1;
+  envd1.default_clang_sysinclude_returns_append("/foo");
+  cached_environment_detector(envd1, cache_file, false)
+    .default_clang_sysinclude("/usr/bin/clang");
+
+  mock_environment_detector envd2;
+  const std::vector<std::string> sysinclude =
+    cached_environment_detector(envd2, cache_file, false)
+      .default_clang_sysinclude("/usr/bin/clang");
+
+  JUST_ASSERT_EQUAL(1, envd1.default_clang_sysinclude_called_times());
+  JUST_ASSERT_EQUAL(0, envd2.default_clang_sysinclude_called_times());
+  JUST_ASSERT_EQUAL(1u, sysinclude.size());
+  JUST_ASSERT_EQUAL("/foo", sysinclude[0]);
+}
+
+JUST_TEST_CASE(test_sysinclude_of_other_clang_binary_is_detected)
+{
+  just::temp::directory d;
+  const std::string cache_file = d.path() + "/cache";
+
+  mock_environment_detector envd;
+  cached_environment_detector det(envd, cache_file, false);
+  det.default_clang_sysinclude("/usr/bin/clang");
+  det.default_clang_sysinclude("/usr/local/bin/clang");
+
+  JUST_ASSERT_EQUAL(2, envd.default_clang_sysinclude_called_times());
+}
+
+JUST_TEST_CASE(test_redetect_ignores_the_cache)
+{
+  just::temp::directory d;
+  const std::string cache_file = d.path() + "/cache";
+
+  mock_environment_detector envd1;
+  cached_environment_detector(envd1, cache_file, false)
+    .default_clang_sysinclude("/usr/bin/clang");
+
+  mock_environment_detector envd2;
+  cached_environment_detector(envd2, cache_file, true)
+    .default_clang_sysinclude("/usr/bin/clang");
+
+  JUST_ASSERT_EQUAL(1, envd2.default_clang_sysinclude_called_times());
+}
+
+JUST_TEST_CASE(test_cached_libclang_compatibility_is_not_detected_again)
+{
+  just::temp::directory d;
+  const std::string cache_file = d.path() + "/cache";
+  config cfg;
+  cfg.clang_path = "/usr/bin/clang";
+
+  mock_environment_detector envd1;
+  envd1.set_clang_binary_works_with_libclang_callback(
+    [](const std::string&) { return false; }
+  );
+  cached_environment_detector(envd1, cache_file, false)
+    .clang_binary_works_with_libclang(cfg);
+
+  mock_environment_detector envd2;
+  const bool works =
+    cached_environment_detector(envd2, cache_file, false)
+      .clang_binary_works_with_libclang(cfg);
+
+  JUST_ASSERT(!works);
+  JUST_ASSERT_EQUAL(0, envd2.clang_binary_works_with_libclang_called_times());
+}
+
+JUST_TEST_CASE(test_environment_detection_is_not_cached_without_cache_file)
+{
+  mock_environment_detector envd;
+  cached_environment_detector det(envd, "", false);
+  det.default_clang_sysinclude("/usr/bin/clang");
+  det.default_clang_sysinclude("/usr/bin/clang");
+
+  JUST_ASSERT_EQUAL(2, envd.default_clang_sysinclude_called_times());
+}
+
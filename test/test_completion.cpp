@@ -110,3 +110,27 @@ JUST_TEST_CASE(test_included_completion)
   JUST_ASSERT_EQUAL(string_set("r"), string_set(sh, "std::vecto"));
 }
 
+
+JUST_TEST_CASE(test_narrowing_the_completion)
+{
+  test_shell sh;
+  sh.store_in_buffer("struct foo { double mem1; char mem2; int other; };");
+
+  JUST_ASSERT_EQUAL(
+    string_set("em1", "em2"),
+    string_set(sh, "decltype(foo().m")
+  );
+  JUST_ASSERT_EQUAL(string_set("1", "2"), string_set(sh, "decltype(foo().mem"));
+  JUST_ASSERT_EQUAL(string_set("her"), string_set(sh, "decltype(foo().ot"));
+}
+
+JUST_TEST_CASE(test_completion_after_changing_the_environment)
+{
+  test_shell sh;
+
+  JUST_ASSERT_EQUAL(string_set(), string_set(sh, "metashell_test_typ"));
+
+  sh.store_in_buffer("typedef int metashell_test_type;");
+
+  JUST_ASSERT_EQUAL(string_set("e"), string_set(sh, "metashell_test_typ"));
+}
@@ -137,6 +137,19 @@ JUST_TEST_CASE(test_standard_to_use_is_kept)
   );
 }
 
+JUST_TEST_CASE(test_templight_trace_format_is_kept)
+{
+  mock_environment_detector dstub;
+
+  user_config ucfg;
+  ucfg.templight_trace_format = templight_format::binary;
+
+  JUST_ASSERT_EQUAL(
+    templight_format::binary,
+    detect_config(ucfg, dstub).templight_trace_format
+  );
+}
+
 JUST_TEST_CASE(test_clang_binary_is_searched_when_not_specified)
 {
   mock_environment_detector envd;
@@ -443,6 +456,35 @@ JUST_TEST_CASE(
   JUST_ASSERT_EQUAL(0, envd.clang_binary_works_with_libclang_called_times());
 }
 
+JUST_TEST_CASE(test_default_pch_dir_is_next_to_the_executable)
+{
+  mock_environment_detector envd;
+  envd.path_of_executable_returns("/foo/bar/metashell");
+
+  std::ostringstream err;
+  const config cfg = detect_config(user_config(), envd, err);
+
+  JUST_ASSERT_EQUAL("/foo/bar/metashell_default_pch", cfg.default_pch_dir);
+}
+
+JUST_TEST_CASE(
+  test_when_precompiling_in_process_clang_is_not_tested_against_libclang
+)
+{
+  mock_environment_detector envd;
+  envd.file_exists_returns(false);
+
+  user_config ucfg;
+  ucfg.use_precompiled_headers = true;
+  ucfg.precompile_in_process = true;
+
+  std::ostringstream err;
+  const config cfg = detect_config(ucfg, envd, err);
+
+  JUST_ASSERT_EQUAL(0, envd.clang_binary_works_with_libclang_called_times());
+  JUST_ASSERT(cfg.use_precompiled_headers);
+}
+
 JUST_TEST_CASE(
   test_when_user_config_does_not_ask_for_precompiled_headers_clang_is_not_tested_against_libclang
 )
@@ -0,0 +1,41 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/default_pch.hpp>
+#include <metashell/config.hpp>
+
+#include <just/test.hpp>
+#include <just/temp.hpp>
+
+using namespace metashell;
+
+JUST_TEST_CASE(test_no_default_pch_without_directory)
+{
+  config cfg;
+  cfg.default_pch_dir = "";
+
+  JUST_ASSERT_EQUAL("", default_pch(cfg));
+}
+
+JUST_TEST_CASE(test_no_default_pch_in_empty_directory)
+{
+  just::temp::directory d;
+  config cfg;
+  cfg.default_pch_dir = d.path();
+
+  JUST_ASSERT_EQUAL("", default_pch(cfg));
+}
+
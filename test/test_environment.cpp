@@ -16,6 +16,7 @@
 
 #include <metashell/header_file_environment.hpp>
 #include <metashell/in_memory_environment.hpp>
+#include <metashell/environment_snapshot.hpp>
 
 #include <metashell/config.hpp>
 
@@ -27,11 +28,24 @@
 
 #include <algorithm>
 #include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
 
 using namespace metashell;
 
 namespace
 {
+  std::string joined(const std::vector<boost::string_ref>& parts_)
+  {
+    std::string result;
+    for (const boost::string_ref& part : parts_)
+    {
+      result.append(part.begin(), part.end());
+    }
+    return result;
+  }
+
   void test_append_text_to_environment(environment& env_)
   {
     env_.append("#include <foo/bar.hpp>\n");
@@ -226,3 +240,107 @@ JUST_TEST_CASE(
   JUST_ASSERT_NOT_EQUAL("", sh.error());
 }
 
+
+JUST_TEST_CASE(test_digest_of_in_memory_environment_depends_on_content_only)
+{
+  const config cfg = empty_config(argv0::get());
+
+  in_memory_environment env1("foo", cfg);
+  env1.append("typedef int x;");
+  env1.append("typedef x y;");
+
+  in_memory_environment env2("foo", cfg);
+  env2.append(env1.get_all());
+
+  in_memory_environment env3("foo", cfg);
+  env3.append("typedef int x;");
+
+  JUST_ASSERT_EQUAL(env1.get_all_digest(), env2.get_all_digest());
+  JUST_ASSERT_NOT_EQUAL(env1.get_all_digest(), env3.get_all_digest());
+}
+
+JUST_TEST_CASE(test_digest_of_in_memory_environment_is_sha1)
+{
+  in_memory_environment env("foo", empty_config(argv0::get()));
+  env.append("abc");
+
+  JUST_ASSERT_EQUAL(
+    "a9993e364706816aba3e25717850c26c9cd0d89d",
+    env.get_all_digest()
+  );
+}
+
+JUST_TEST_CASE(test_environment_snapshot_is_not_changed_with_the_environment)
+{
+  const config cfg = empty_config(argv0::get());
+
+  in_memory_environment env("foo", cfg);
+  env.append("typedef int x;");
+
+  const environment_snapshot snapshot(env);
+  const std::string all = env.get_all();
+  const std::string digest = env.get_all_digest();
+
+  env.append("typedef x y;");
+
+  JUST_ASSERT_EQUAL(all, snapshot.get_all());
+  JUST_ASSERT_EQUAL(digest, snapshot.get_all_digest());
+  JUST_ASSERT_EQUAL("typedef int x;\nint", snapshot.get_appended("int"));
+}
+
+JUST_TEST_CASE(test_parts_of_in_memory_environment_are_its_code)
+{
+  in_memory_environment parent("foo", empty_config(argv0::get()));
+  parent.append("typedef int x;");
+
+  const std::unique_ptr<environment> child = parent.create_child();
+  child->append("typedef x y;");
+
+  const std::vector<boost::string_ref> parts = child->get_parts();
+
+  // The part of the parent is shared, not copied
+  JUST_ASSERT_EQUAL(2u, parts.size());
+  JUST_ASSERT_EQUAL(child->get(), joined(parts));
+  JUST_ASSERT_EQUAL(child->get_all_digest(), child->get_digest());
+}
+
+JUST_TEST_CASE(test_parts_of_environment_snapshot_are_its_code)
+{
+  in_memory_environment env("foo", empty_config(argv0::get()));
+  env.append("typedef int x;");
+
+  const environment_snapshot snapshot(env);
+
+  JUST_ASSERT_EQUAL(env.get(), joined(snapshot.get_parts()));
+  JUST_ASSERT_EQUAL(env.get_digest(), snapshot.get_digest());
+}
+
+JUST_TEST_CASE(test_child_of_in_memory_environment_extends_the_parent)
+{
+  in_memory_environment parent("foo", empty_config(argv0::get()));
+  parent.append("typedef int x;");
+
+  const std::unique_ptr<environment> child = parent.create_child();
+  child->append("typedef x y;");
+
+  JUST_ASSERT_EQUAL("typedef int x;\ntypedef x y;", child->get_all());
+  JUST_ASSERT_EQUAL(
+    "typedef int x;\ntypedef x y;\nint",
+    child->get_appended("int")
+  );
+  JUST_ASSERT_EQUAL("typedef int x;", parent.get_all());
+}
+
+JUST_TEST_CASE(test_appending_to_parent_does_not_change_in_memory_child)
+{
+  in_memory_environment parent("foo", empty_config(argv0::get()));
+  parent.append("typedef int x;");
+
+  const std::unique_ptr<environment> child = parent.create_child();
+  const std::string digest = child->get_all_digest();
+  parent.append("typedef x y;");
+
+  JUST_ASSERT_EQUAL("typedef int x;", child->get_all());
+  JUST_ASSERT_EQUAL(digest, child->get_all_digest());
+  JUST_ASSERT_EQUAL("typedef int x;\ntypedef x y;", parent.get_all());
+}
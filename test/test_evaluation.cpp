@@ -19,9 +19,13 @@
 
 #include <metashell/metashell.hpp>
 #include <metashell/path_builder.hpp>
+#include <metashell/in_memory_environment.hpp>
 
 #include <just/test.hpp>
 
+#include <string>
+#include <vector>
+
 JUST_TEST_CASE(test_non_existing_class)
 {
   test_shell sh;
@@ -371,3 +375,129 @@ JUST_TEST_CASE(test_prompt_is_different_in_multiline_input)
   JUST_ASSERT_EQUAL("...> ", sh.prompt());
 }
 
+JUST_TEST_CASE(test_query_after_failing_query)
+{
+  test_shell sh;
+  sh.line_available("hello");
+  JUST_ASSERT(!sh.error().empty());
+
+  sh.line_available("int");
+  JUST_ASSERT_EQUAL("int", sh.output());
+}
+
+JUST_TEST_CASE(test_query_sees_environment_extended_after_previous_query)
+{
+  test_shell sh;
+  sh.line_available("int");
+  sh.line_available("typedef double x;");
+  sh.line_available("x");
+
+  JUST_ASSERT_EQUAL("", sh.error());
+  JUST_ASSERT_EQUAL("intdouble", sh.output());
+}
+
+JUST_TEST_CASE(test_evaluating_multiple_metaprograms)
+{
+  test_shell sh;
+  sh.line_available("typedef int x;");
+
+  std::vector<std::string> exps;
+  exps.push_back("x");
+  exps.push_back("double");
+  sh.run_metaprograms(exps);
+
+  JUST_ASSERT_EQUAL("", sh.error());
+  JUST_ASSERT_EQUAL("intdouble", sh.output());
+}
+
+JUST_TEST_CASE(test_errors_of_multiple_metaprograms_belong_to_their_query)
+{
+  metashell::config cfg;
+  metashell::in_memory_environment env("__metashell_internal", cfg);
+  env.append(
+    "namespace metashell { namespace impl {"
+      "template <class T> struct wrap {};"
+    "} template <class T> struct format { typedef T type; }; }"
+  );
+
+  std::vector<std::string> exps;
+  exps.push_back("int");
+  exps.push_back("nonexisting_type");
+  exps.push_back("char");
+
+  const std::vector<metashell::result>
+    r = metashell::eval_tmp_formatted(env, exps, cfg, "<input>");
+
+  JUST_ASSERT_EQUAL(3u, r.size());
+
+  JUST_ASSERT(!r[0].has_errors());
+  JUST_ASSERT_EQUAL("int", r[0].output);
+
+  JUST_ASSERT(r[1].has_errors());
+
+  JUST_ASSERT(!r[2].has_errors());
+  JUST_ASSERT_EQUAL("char", r[2].output);
+}
+
+JUST_TEST_CASE(test_many_metaprograms_are_evaluated_in_one_parse)
+{
+  metashell::config cfg;
+  cfg.verbose = true;
+  metashell::in_memory_environment env("__metashell_internal", cfg);
+  env.append(
+    "namespace metashell { namespace impl {"
+      "template <class T> struct wrap {};"
+    "} template <class T> struct format { typedef T type; }; }"
+  );
+
+  // Every query emits two separator errors, they are more than the default
+  // error limit of clang
+  std::vector<std::string> exps(12, "int");
+  exps[5] = "nonexisting_type";
+
+  const std::vector<metashell::result>
+    r = metashell::eval_tmp_formatted(env, exps, cfg, "<input>");
+
+  JUST_ASSERT_EQUAL(exps.size(), r.size());
+  for (std::vector<metashell::result>::size_type i = 0; i != r.size(); ++i)
+  {
+    // The queries evaluated one by one have the code of their own parse in
+    // the info
+    JUST_ASSERT(r[i].info.find("__metashell_query_11") != std::string::npos);
+    if (i == 5)
+    {
+      JUST_ASSERT(r[i].has_errors());
+    }
+    else
+    {
+      JUST_ASSERT(!r[i].has_errors());
+      JUST_ASSERT_EQUAL("int", r[i].output);
+    }
+  }
+}
+
+JUST_TEST_CASE(test_lines_evaluated_in_parallel_are_displayed_in_order)
+{
+  test_shell sh;
+
+  std::vector<std::string> lines;
+  lines.push_back("int");
+  lines.push_back("typedef double x;");
+  lines.push_back("x");
+  lines.push_back("char");
+  lines.push_back("long");
+  sh.lines_available(lines, 2);
+
+  JUST_ASSERT_EQUAL("", sh.error());
+  JUST_ASSERT_EQUAL("intdoublecharlong", sh.output());
+}
+
+JUST_TEST_CASE(test_cancelling_while_idle_does_not_affect_next_query)
+{
+  test_shell sh;
+  sh.cancel_operation();
+  sh.line_available("int");
+
+  JUST_ASSERT_EQUAL("", sh.error());
+  JUST_ASSERT_EQUAL("int", sh.output());
+}
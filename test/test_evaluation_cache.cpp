@@ -0,0 +1,151 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/evaluation_cache.hpp>
+#include <metashell/in_memory_environment.hpp>
+#include <metashell/config.hpp>
+
+#include "test_shell.hpp"
+
+#include <just/test.hpp>
+
+#include <string>
+
+using namespace metashell;
+
+namespace
+{
+  result result_with_output(const std::string& output_)
+  {
+    result r;
+    r.output = output_;
+    return r;
+  }
+}
+
+JUST_TEST_CASE(test_evaluation_cache_is_empty_by_default)
+{
+  const evaluation_cache c(10);
+
+  JUST_ASSERT_EQUAL(0, c.size());
+  JUST_ASSERT_EQUAL(0, c.hits());
+  JUST_ASSERT_EQUAL(0, c.misses());
+}
+
+JUST_TEST_CASE(test_evaluation_cache_returns_added_result)
+{
+  const config cfg;
+  const in_memory_environment env("__metashell_internal", cfg);
+  evaluation_cache c(10);
+
+  c.add(env, cfg, "int", result_with_output("int"));
+  const boost::optional<result> r = c.find(env, cfg, "int");
+
+  JUST_ASSERT(bool(r));
+  JUST_ASSERT_EQUAL("int", r->output);
+  JUST_ASSERT_EQUAL(1, c.hits());
+  JUST_ASSERT_EQUAL(0, c.misses());
+}
+
+JUST_TEST_CASE(test_evaluation_cache_misses_for_different_environment)
+{
+  const config cfg;
+  in_memory_environment env("__metashell_internal", cfg);
+  evaluation_cache c(10);
+
+  c.add(env, cfg, "int", result_with_output("int"));
+  env.append("typedef int x;");
+
+  JUST_ASSERT(!c.find(env, cfg, "int"));
+  JUST_ASSERT_EQUAL(0, c.hits());
+  JUST_ASSERT_EQUAL(1, c.misses());
+}
+
+JUST_TEST_CASE(test_evaluation_cache_drops_least_recently_used_entry)
+{
+  const config cfg;
+  const in_memory_environment env("__metashell_internal", cfg);
+  evaluation_cache c(2);
+
+  c.add(env, cfg, "int", result_with_output("int"));
+  c.add(env, cfg, "char", result_with_output("char"));
+  c.find(env, cfg, "int");
+  c.add(env, cfg, "double", result_with_output("double"));
+
+  JUST_ASSERT_EQUAL(2, c.size());
+  JUST_ASSERT(bool(c.find(env, cfg, "int")));
+  JUST_ASSERT(!c.find(env, cfg, "char"));
+  JUST_ASSERT(bool(c.find(env, cfg, "double")));
+}
+
+JUST_TEST_CASE(test_evaluation_cache_with_zero_size_stores_nothing)
+{
+  const config cfg;
+  const in_memory_environment env("__metashell_internal", cfg);
+  evaluation_cache c(0);
+
+  c.add(env, cfg, "int", result_with_output("int"));
+
+  JUST_ASSERT_EQUAL(0, c.size());
+  JUST_ASSERT(!c.find(env, cfg, "int"));
+}
+
+JUST_TEST_CASE(test_clearing_evaluation_cache)
+{
+  const config cfg;
+  const in_memory_environment env("__metashell_internal", cfg);
+  evaluation_cache c(10);
+
+  c.add(env, cfg, "int", result_with_output("int"));
+  c.find(env, cfg, "int");
+  c.clear();
+
+  JUST_ASSERT_EQUAL(0, c.size());
+  JUST_ASSERT_EQUAL(0, c.hits());
+  JUST_ASSERT_EQUAL(0, c.misses());
+}
+
+JUST_TEST_CASE(test_repeated_query_is_served_from_evaluation_cache)
+{
+  test_shell sh;
+  sh.clear_evaluation_cache();
+
+  sh.line_available("int");
+  sh.line_available("int");
+
+  JUST_ASSERT_EQUAL("intint", sh.output());
+  JUST_ASSERT_EQUAL(1, sh.get_evaluation_cache().hits());
+  JUST_ASSERT_EQUAL(1, sh.get_evaluation_cache().misses());
+}
+
+JUST_TEST_CASE(test_pragma_cache_displays_statistics)
+{
+  test_shell sh;
+  sh.line_available("#msh cache");
+
+  JUST_ASSERT_EQUAL("", sh.error());
+  JUST_ASSERT_NOT_EQUAL("", sh.output());
+}
+
+JUST_TEST_CASE(test_pragma_cache_clear_empties_the_cache)
+{
+  test_shell sh;
+  sh.line_available("int");
+  sh.line_available("#msh cache clear");
+
+  JUST_ASSERT_EQUAL("", sh.error());
+  JUST_ASSERT_EQUAL(0, sh.get_evaluation_cache().size());
+}
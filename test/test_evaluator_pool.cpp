@@ -0,0 +1,212 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/evaluator_pool.hpp>
+#include <metashell/in_memory_environment.hpp>
+#include <metashell/config.hpp>
+#include <metashell/timing.hpp>
+
+#include <just/test.hpp>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+using namespace metashell;
+
+#ifndef _WIN32
+
+namespace
+{
+  void add_formatter(environment& env_)
+  {
+    env_.append(
+      "namespace metashell { namespace impl {"
+        "template <class T> struct wrap {};"
+      "} template <class T> struct format { typedef T type; }; }"
+    );
+  }
+
+  bool has_stage(const timing& t_, const std::string& name_)
+  {
+    for (const std::pair<std::string, double>& s : t_.get_stages())
+    {
+      if (s.first == name_)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+}
+
+JUST_TEST_CASE(test_evaluating_in_evaluator_process)
+{
+  config cfg;
+  cfg.evaluator_processes = 1;
+  in_memory_environment env("__metashell_internal", cfg);
+  add_formatter(env);
+
+  evaluator_pool pool(cfg);
+  const boost::optional<result>
+    r = pool.eval_tmp_formatted(env, "int", cfg, "<input>");
+
+  JUST_ASSERT(r != boost::none);
+  JUST_ASSERT(!r->has_errors());
+  JUST_ASSERT(!r->resource_limit_exceeded);
+  JUST_ASSERT_EQUAL("int", r->output);
+}
+
+JUST_TEST_CASE(test_evaluating_multiple_metaprograms_in_evaluator_process)
+{
+  config cfg;
+  cfg.evaluator_processes = 1;
+  in_memory_environment env("__metashell_internal", cfg);
+  add_formatter(env);
+
+  std::vector<std::string> tmps;
+  tmps.push_back("int");
+  tmps.push_back("char");
+
+  evaluator_pool pool(cfg);
+  const boost::optional<std::vector<result>>
+    r = pool.eval_tmp_formatted(env, tmps, cfg, "<input>");
+
+  JUST_ASSERT(r != boost::none);
+  JUST_ASSERT_EQUAL(2u, r->size());
+  JUST_ASSERT_EQUAL("int", (*r)[0].output);
+  JUST_ASSERT_EQUAL("char", (*r)[1].output);
+}
+
+JUST_TEST_CASE(test_timing_of_evaluator_process_is_added_to_the_shell)
+{
+  config cfg;
+  cfg.evaluator_processes = 1;
+  in_memory_environment env("__metashell_internal", cfg);
+  add_formatter(env);
+
+  evaluator_pool pool(cfg);
+  timing t;
+  {
+    timing_recorder recorder(t);
+    pool.eval_tmp_formatted(env, "int", cfg, "<input>");
+  }
+
+  // The code is parsed only in the worker
+  JUST_ASSERT(has_stage(t, "evaluator process"));
+  JUST_ASSERT(has_stage(t, "parse"));
+  JUST_ASSERT(!t.get_resources().empty());
+}
+
+JUST_TEST_CASE(test_evaluator_process_sees_the_extended_environment)
+{
+  config cfg;
+  cfg.evaluator_processes = 1;
+  in_memory_environment env("__metashell_internal", cfg);
+  add_formatter(env);
+
+  evaluator_pool pool(cfg);
+  // The worker keeps the environment it received and gets it again only
+  // after it changes
+  JUST_ASSERT_EQUAL(
+    "int",
+    pool.eval_tmp_formatted(env, "int", cfg, "<input>")->output
+  );
+  env.append("typedef char x;");
+
+  JUST_ASSERT_EQUAL(
+    "char",
+    pool.eval_tmp_formatted(env, "x", cfg, "<input>")->output
+  );
+}
+
+JUST_TEST_CASE(test_validating_in_evaluator_process)
+{
+  config cfg;
+  cfg.evaluator_processes = 1;
+  in_memory_environment env("__metashell_internal", cfg);
+
+  evaluator_pool pool(cfg);
+
+  JUST_ASSERT(
+    !pool.validate_code("typedef int x;", cfg, env, "<input>")->has_errors()
+  );
+  JUST_ASSERT(
+    pool.validate_code("typedef nonexisting x;", cfg, env, "<input>")
+      ->has_errors()
+  );
+}
+
+JUST_TEST_CASE(test_evaluator_processes_are_recycled)
+{
+  config cfg;
+  cfg.evaluator_processes = 1;
+  cfg.evaluator_queries_per_process = 1;
+  in_memory_environment env("__metashell_internal", cfg);
+  add_formatter(env);
+
+  evaluator_pool pool(cfg);
+
+  JUST_ASSERT_EQUAL(
+    "int",
+    pool.eval_tmp_formatted(env, "int", cfg, "<input>")->output
+  );
+  JUST_ASSERT_EQUAL(
+    "char",
+    pool.eval_tmp_formatted(env, "char", cfg, "<input>")->output
+  );
+}
+
+JUST_TEST_CASE(test_evaluator_process_exceeding_memory_limit)
+{
+  config cfg;
+  cfg.evaluator_processes = 1;
+  cfg.evaluator_memory_limit_mb = 1;
+  in_memory_environment env("__metashell_internal", cfg);
+  add_formatter(env);
+
+  evaluator_pool pool(cfg);
+  const boost::optional<result>
+    r = pool.eval_tmp_formatted(env, "int", cfg, "<input>");
+
+  JUST_ASSERT(r != boost::none);
+  JUST_ASSERT(r->resource_limit_exceeded);
+  JUST_ASSERT(r->has_errors());
+}
+
+JUST_TEST_CASE(test_cancelled_evaluation_replaces_the_evaluator_process)
+{
+  config cfg;
+  cfg.evaluator_processes = 1;
+  in_memory_environment env("__metashell_internal", cfg);
+  add_formatter(env);
+
+  evaluator_pool pool(cfg);
+
+  const std::atomic<bool> cancelled(true);
+  JUST_ASSERT(
+    pool.eval_tmp_formatted(env, "int", cfg, "<input>", &cancelled)
+      == boost::none
+  );
+
+  JUST_ASSERT_EQUAL(
+    "char",
+    pool.eval_tmp_formatted(env, "char", cfg, "<input>")->output
+  );
+}
+
+#endif
+
@@ -0,0 +1,34 @@
+# Metashell - Interactive C++ template metaprogramming shell
+# Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+# Runs Metashell with a batch file that does not exist and checks that the
+# error is displayed and reported in the exit code
+
+execute_process(
+  COMMAND ${METASHELL} --batch ${BATCH_FILE}
+  RESULT_VARIABLE EXIT_CODE
+  OUTPUT_QUIET
+  ERROR_VARIABLE ERROR_OUTPUT
+)
+
+if (NOT "${EXIT_CODE}" STREQUAL "1")
+  message(FATAL_ERROR "Exit code: ${EXIT_CODE}, expected: 1")
+endif()
+
+if (NOT "${ERROR_OUTPUT}" MATCHES "Error: Failed to open")
+  message(FATAL_ERROR "Unexpected error output: ${ERROR_OUTPUT}")
+endif()
@@ -107,3 +107,28 @@ JUST_TEST_CASE(test_nested_mpl_vector_formatting)
   );
 }
 
+
+JUST_TEST_CASE(test_error_in_query_is_not_reported_for_formatting)
+{
+  test_shell sh;
+  sh.line_available("hello");
+
+  JUST_ASSERT_EQUAL("", sh.output());
+  JUST_ASSERT_NOT_EQUAL("", sh.error());
+  JUST_ASSERT(sh.error().find("__metashell_formatted") == std::string::npos);
+}
+
+JUST_TEST_CASE(test_error_in_formatter_is_reported)
+{
+  test_shell sh;
+  sh.line_available(
+    "namespace metashell { template <> struct format<int> {}; }"
+  );
+  sh.line_available("int");
+
+  JUST_ASSERT_EQUAL("", sh.output());
+  JUST_ASSERT_NOT_EQUAL("", sh.error());
+  JUST_ASSERT(
+    sh.error().find("__metashell_formatted_part") == std::string::npos
+  );
+}
@@ -0,0 +1,102 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/json_shell.hpp>
+#include <metashell/config.hpp>
+
+#include "argv0.hpp"
+
+#include <just/test.hpp>
+
+#include <string>
+
+using namespace metashell;
+
+namespace
+{
+  config json_shell_config()
+  {
+    config cfg = empty_config(argv0::get());
+#ifdef WINDOWS_HEADERS
+    const std::string windows_headers = WINDOWS_HEADERS;
+    cfg.include_path.push_back(windows_headers);
+    cfg.include_path.push_back(windows_headers + "\\mingw32");
+#endif
+    cfg.include_path.push_back(BOOST_INCLUDE_PATH);
+    return cfg;
+  }
+}
+
+JUST_TEST_CASE(test_json_shell_evaluate)
+{
+  json_shell sh(json_shell_config());
+
+  JUST_ASSERT_EQUAL(
+    "{\"id\":\"1\",\"output\":[\"int\"],\"info\":[],\"errors\":[]}",
+    sh.process_request(
+      "{\"id\": \"1\", \"type\": \"evaluate\", \"code\": \"int\"}"
+    )
+  );
+}
+
+JUST_TEST_CASE(test_json_shell_environment_add)
+{
+  json_shell sh(json_shell_config());
+
+  sh.process_request(
+    "{\"type\": \"environment_add\", \"code\": \"typedef int x;\"}"
+  );
+
+  JUST_ASSERT_EQUAL(
+    "{\"id\":\"\",\"output\":[\"int\"],\"info\":[],\"errors\":[]}",
+    sh.process_request("{\"type\": \"evaluate\", \"code\": \"x\"}")
+  );
+}
+
+JUST_TEST_CASE(test_json_shell_environment_push_and_pop)
+{
+  json_shell sh(json_shell_config());
+
+  sh.process_request("{\"type\": \"environment_push\"}");
+  sh.process_request(
+    "{\"type\": \"environment_add\", \"code\": \"typedef int x;\"}"
+  );
+  sh.process_request("{\"type\": \"environment_pop\"}");
+
+  JUST_ASSERT_EQUAL(
+    "{\"id\":\"\",\"output\":[],\"info\":[],\"errors\":[],\"valid\":true}",
+    sh.process_request("{\"type\": \"validate\", \"code\": \"int x;\"}")
+  );
+}
+
+JUST_TEST_CASE(test_json_shell_invalid_request)
+{
+  json_shell sh(json_shell_config());
+
+  const std::string r = sh.process_request("not json");
+
+  JUST_ASSERT_NOT_EQUAL(std::string::npos, r.find("\"errors\":[\"Error: "));
+}
+
+JUST_TEST_CASE(test_json_shell_shutdown)
+{
+  json_shell sh(json_shell_config());
+
+  sh.process_request("{\"type\": \"shutdown\"}");
+
+  JUST_ASSERT(sh.stopped());
+}
+
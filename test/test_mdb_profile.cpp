@@ -0,0 +1,112 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mdb_test_shell.hpp"
+
+#include "test_metaprograms.hpp"
+
+#include <just/test.hpp>
+
+#include <algorithm>
+
+using namespace metashell;
+
+namespace {
+  const std::string profile_header =
+    "   Count   Self (ms)  Total (ms)  Name\n";
+}
+
+#ifndef METASHELL_DISABLE_TEMPLIGHT_TESTS
+JUST_TEST_CASE(test_mdb_profile_without_evaluation) {
+  mdb_test_shell sh;
+
+  sh.line_available("profile");
+
+  JUST_ASSERT_EQUAL(sh.get_output(),
+      "Metaprogram not evaluated yet\n");
+}
+#endif
+
+#ifndef METASHELL_DISABLE_TEMPLIGHT_TESTS
+JUST_TEST_CASE(test_mdb_profile_garbage_argument) {
+  mdb_test_shell sh(fibonacci_mp);
+
+  sh.line_available("evaluate int_<fib<10>::value>");
+
+  sh.clear_output();
+  sh.line_available("profile asd");
+
+  JUST_ASSERT_EQUAL(sh.get_output(), "Argument parsing failed\n");
+}
+#endif
+
+#ifndef METASHELL_DISABLE_TEMPLIGHT_TESTS
+JUST_TEST_CASE(test_mdb_profile_wrong_argument_order) {
+  mdb_test_shell sh(fibonacci_mp);
+
+  sh.line_available("evaluate int_<fib<10>::value>");
+
+  sh.clear_output();
+  sh.line_available("profile count templates");
+
+  JUST_ASSERT_EQUAL(sh.get_output(), "Argument parsing failed\n");
+}
+#endif
+
+#ifndef METASHELL_DISABLE_TEMPLIGHT_TESTS
+JUST_TEST_CASE(test_mdb_profile_limits_the_number_of_entries) {
+  mdb_test_shell sh(fibonacci_mp);
+
+  sh.line_available("evaluate int_<fib<10>::value>");
+
+  sh.clear_output();
+  sh.line_available("profile count 3");
+
+  const std::string& output = sh.get_output();
+  JUST_ASSERT_EQUAL(profile_header, output.substr(0, profile_header.size()));
+  JUST_ASSERT_EQUAL(4, std::count(output.begin(), output.end(), '\n'));
+}
+#endif
+
+#ifndef METASHELL_DISABLE_TEMPLIGHT_TESTS
+JUST_TEST_CASE(test_mdb_profile_templates) {
+  mdb_test_shell sh(fibonacci_mp);
+
+  sh.line_available("evaluate int_<fib<10>::value>");
+
+  sh.clear_output();
+  sh.line_available("profile templates count 1");
+
+  const std::string& output = sh.get_output();
+  JUST_ASSERT_EQUAL(profile_header, output.substr(0, profile_header.size()));
+  JUST_ASSERT(output.find("  fib\n") != std::string::npos);
+}
+#endif
+
+#ifndef METASHELL_DISABLE_TEMPLIGHT_TESTS
+JUST_TEST_CASE(test_mdb_profile_memory_without_recording_it) {
+  mdb_test_shell sh(fibonacci_mp);
+
+  sh.line_available("evaluate int_<fib<10>::value>");
+
+  sh.clear_output();
+  sh.line_available("profile memory");
+
+  JUST_ASSERT_EQUAL(sh.get_output(),
+      "Memory usage is not recorded, start Metashell with"
+      " --templight_memory\n");
+}
+#endif
@@ -18,6 +18,9 @@
 
 #include <just/test.hpp>
 
+#include <vector>
+#include <algorithm>
+
 using namespace metashell;
 
 template<class T>
@@ -93,7 +96,7 @@ JUST_TEST_CASE(test_metaprogram_with_single_non_root_vertex) {
   JUST_ASSERT_EQUAL(mp.get_vertex_property(vertex_a).name, "A");
   JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a).kind,
       instantiation_kind::template_instantiation);
-  JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a).point_of_instantiation,
+  JUST_ASSERT_EQUAL(mp.get_point_of_instantiation(edge_root_a),
       file_location("foo.cpp", 10, 20));
 
   assert_state_equal(mp.get_state(),
@@ -142,11 +145,11 @@ JUST_TEST_CASE(test_metaprogram_with_single_non_root_vertex_parallel_edge) {
   JUST_ASSERT_EQUAL(mp.get_vertex_property(vertex_a).name, "A");
   JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a_ti).kind,
       instantiation_kind::template_instantiation);
-  JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a_ti).point_of_instantiation,
+  JUST_ASSERT_EQUAL(mp.get_point_of_instantiation(edge_root_a_ti),
       file_location("bar.cpp", 20, 10));
   JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a_me).kind,
       instantiation_kind::memoization);
-  JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a_me).point_of_instantiation,
+  JUST_ASSERT_EQUAL(mp.get_point_of_instantiation(edge_root_a_me),
       file_location("foobar.cpp", 21, 11));
 
   assert_state_equal(mp.get_state(),
@@ -202,7 +205,7 @@ JUST_TEST_CASE(test_metaprogram_step_back_with_single_non_root_vertex) {
   JUST_ASSERT_EQUAL(mp.get_vertex_property(vertex_a).name, "A");
   JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a).kind,
       instantiation_kind::template_instantiation);
-  JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a).point_of_instantiation,
+  JUST_ASSERT_EQUAL(mp.get_point_of_instantiation(edge_root_a),
       file_location("foobar.cpp", 21, 11));
 
   assert_state_equal(mp.get_state(),
@@ -253,11 +256,11 @@ JUST_TEST_CASE(
   JUST_ASSERT_EQUAL(mp.get_vertex_property(vertex_a).name, "A");
   JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a_ti).kind,
       instantiation_kind::template_instantiation);
-  JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a_ti).point_of_instantiation,
+  JUST_ASSERT_EQUAL(mp.get_point_of_instantiation(edge_root_a_ti),
       file_location("xx.cpp", 1, 2));
   JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a_me).kind,
       instantiation_kind::memoization);
-  JUST_ASSERT_EQUAL(mp.get_edge_property(edge_root_a_me).point_of_instantiation,
+  JUST_ASSERT_EQUAL(mp.get_point_of_instantiation(edge_root_a_me),
       file_location("yy.cpp", 1, 2));
 
   assert_state_equal(mp.get_state(),
@@ -328,3 +331,44 @@ JUST_TEST_CASE(
   JUST_ASSERT(mp.is_at_start());
   JUST_ASSERT(!mp.is_finished());
 }
+
+JUST_TEST_CASE(test_metaprogram_edges_after_adding_more_edges) {
+  metaprogram mp("some_type", "the_result_type");
+  metaprogram::vertex_descriptor vertex_a = mp.add_vertex("A");
+  metaprogram::vertex_descriptor vertex_b = mp.add_vertex("B");
+  metaprogram::edge_descriptor edge_root_a =
+    mp.add_edge(mp.get_root_vertex(), vertex_a,
+        instantiation_kind::template_instantiation,
+        file_location("foo.cpp", 10, 20));
+  metaprogram::edge_descriptor edge_a_b =
+    mp.add_edge(vertex_a, vertex_b,
+        instantiation_kind::template_instantiation,
+        file_location("foo.cpp", 11, 20));
+
+  JUST_ASSERT_EQUAL(mp.get_out_edges(mp.get_root_vertex()).size(), 1u);
+  JUST_ASSERT(mp.find_edge(mp.get_root_vertex(), vertex_b) == boost::none);
+
+  metaprogram::edge_descriptor edge_root_b =
+    mp.add_edge(mp.get_root_vertex(), vertex_b,
+        instantiation_kind::memoization,
+        file_location("bar.cpp", 12, 20));
+
+  const std::vector<metaprogram::edge_descriptor>
+    root_out_edges = {edge_root_a, edge_root_b},
+    b_in_edges = {edge_a_b, edge_root_b};
+
+  JUST_ASSERT(
+    std::equal(
+      root_out_edges.begin(),
+      root_out_edges.end(),
+      mp.get_out_edges(mp.get_root_vertex()).begin()));
+  JUST_ASSERT(
+    std::equal(
+      b_in_edges.begin(),
+      b_in_edges.end(),
+      mp.get_in_edges(vertex_b).begin()));
+  JUST_ASSERT(mp.find_edge(mp.get_root_vertex(), vertex_b) == edge_root_b);
+  JUST_ASSERT_EQUAL(mp.get_point_of_instantiation(edge_root_b),
+      file_location("bar.cpp", 12, 20));
+  JUST_ASSERT_EQUAL(mp.get_file_names().size(), 2u);
+}
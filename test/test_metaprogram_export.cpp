@@ -0,0 +1,147 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <metashell/metaprogram_export.hpp>
+
+#include <just/test.hpp>
+
+#include <sstream>
+
+using namespace metashell;
+
+namespace {
+
+std::string template_begin(
+    const std::string& kind,
+    const std::string& context,
+    const std::string& time)
+{
+  return
+    "<TemplateBegin>\n"
+    "<Kind>" + kind + "</Kind>\n"
+    "<Context context = \"" + context + "\"/>\n"
+    "<PointOfInstantiation>foo.hpp|10|20</PointOfInstantiation>\n"
+    "<TimeStamp time = \"" + time + "\"/>\n"
+    "<MemoryUsage bytes = \"0\"/>\n"
+    "</TemplateBegin>\n";
+}
+
+std::string template_end(const std::string& kind, const std::string& time) {
+  return
+    "<TemplateEnd>\n"
+    "<Kind>" + kind + "</Kind>\n"
+    "<TimeStamp time = \"" + time + "\"/>\n"
+    "<MemoryUsage bytes = \"0\"/>\n"
+    "</TemplateEnd>\n";
+}
+
+// foo<int> instantiates bar<int> and bar<char>, bar<int> is memoized later
+metaprogram exported_metaprogram() {
+  const std::string ti = "TemplateInstantiation";
+  const std::string memo = "Memoization";
+  return metaprogram::create_from_xml_string(
+      "<?xml version=\"1.0\" standalone=\"yes\"?>\n"
+      "<Trace>\n" +
+      template_begin(ti, "foo&lt;int&gt;", "1.0") +
+        template_begin(ti, "bar&lt;int&gt;", "1.25") +
+        template_end(ti, "1.5") +
+        template_begin(ti, "bar&lt;char&gt;", "1.5") +
+        template_end(ti, "1.75") +
+      template_end(ti, "2.0") +
+      template_begin(memo, "bar&lt;int&gt;", "2.0") +
+      template_end(memo, "2.5") +
+      "</Trace>\n",
+      "some_type",
+      "the_result_type");
+}
+
+}
+
+JUST_TEST_CASE(test_folded_stacks_export)
+{
+  std::ostringstream s;
+  write_folded_stacks(exported_metaprogram(), s);
+
+  JUST_ASSERT_EQUAL(
+    "some_type;foo<int> 500000\n"
+    "some_type;foo<int>;bar<int> 250000\n"
+    "some_type;foo<int>;bar<char> 250000\n"
+    "some_type;bar<int> 500000\n",
+    s.str());
+}
+
+JUST_TEST_CASE(test_folded_stacks_export_skips_disabled_edges)
+{
+  metaprogram mp = exported_metaprogram();
+  mp.disable_edges_if(
+    [&mp](const metaprogram::edge_descriptor& edge) {
+      return mp.get_edge_property(edge).kind == instantiation_kind::memoization;
+    });
+
+  std::ostringstream s;
+  write_folded_stacks(mp, s);
+
+  JUST_ASSERT_EQUAL(
+    "some_type;foo<int> 500000\n"
+    "some_type;foo<int>;bar<int> 250000\n"
+    "some_type;foo<int>;bar<char> 250000\n",
+    s.str());
+}
+
+JUST_TEST_CASE(test_chrome_trace_export)
+{
+  std::ostringstream s;
+  write_chrome_trace(exported_metaprogram(), s);
+
+  const std::string location =
+    ",\"pid\":1,\"tid\":1,\"args\":{\"point_of_instantiation\":\"foo.hpp\""
+    ",\"row\":10,\"column\":20}}";
+
+  JUST_ASSERT_EQUAL(
+    "{\"traceEvents\":[\n"
+    "{\"name\":\"foo<int>\",\"cat\":\"TemplateInstantiation\",\"ph\":\"B\""
+      ",\"ts\":0.000" + location + ",\n"
+    "{\"name\":\"bar<int>\",\"cat\":\"TemplateInstantiation\",\"ph\":\"B\""
+      ",\"ts\":250000.000" + location + ",\n"
+    "{\"ph\":\"E\",\"ts\":500000.000,\"pid\":1,\"tid\":1},\n"
+    "{\"name\":\"bar<char>\",\"cat\":\"TemplateInstantiation\",\"ph\":\"B\""
+      ",\"ts\":500000.000" + location + ",\n"
+    "{\"ph\":\"E\",\"ts\":750000.000,\"pid\":1,\"tid\":1},\n"
+    "{\"ph\":\"E\",\"ts\":1000000.000,\"pid\":1,\"tid\":1},\n"
+    "{\"name\":\"bar<int>\",\"cat\":\"Memoization\",\"ph\":\"B\""
+      ",\"ts\":1000000.000" + location + ",\n"
+    "{\"ph\":\"E\",\"ts\":1500000.000,\"pid\":1,\"tid\":1}\n"
+    "],\"displayTimeUnit\":\"ms\"}\n",
+    s.str());
+}
+
+JUST_TEST_CASE(test_chrome_trace_export_escapes_names)
+{
+  metaprogram mp("root", "result");
+  mp.add_edge(
+    mp.get_root_vertex(),
+    mp.add_vertex("foo<\"\\\">"),
+    instantiation_kind::template_instantiation,
+    file_location("a.hpp", 1, 2));
+
+  std::ostringstream s;
+  write_chrome_trace(mp, s);
+
+  JUST_ASSERT(
+    s.str().find("\"name\":\"foo<\\\"\\\\\\\">\"") != std::string::npos
+  );
+}
@@ -0,0 +1,246 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <metashell/exception.hpp>
+#include <metashell/metaprogram.hpp>
+
+
+#include <just/test.hpp>
+
+#include <cstring>
+#include <cstdint>
+
+using namespace metashell;
+
+namespace {
+
+// Writes traces in the binary format of templight
+class binary_trace {
+public:
+  binary_trace() : data("TLBT") {
+    append_integer(data, 1, 4);
+  }
+
+  binary_trace& begin(
+      unsigned kind,
+      const std::string& context,
+      const std::string& file,
+      unsigned line,
+      unsigned column,
+      double timestamp)
+  {
+    std::string payload = common_part(true, kind, timestamp);
+    append_string(payload, context);
+    append_string(payload, file);
+    append_integer(payload, line, 4);
+    append_integer(payload, column, 4);
+    append_payload(payload);
+    return *this;
+  }
+
+  binary_trace& end(unsigned kind, double timestamp) {
+    append_payload(common_part(false, kind, timestamp));
+    return *this;
+  }
+
+  const std::string& str() const {
+    return data;
+  }
+
+private:
+  static void append_integer(
+      std::string& out, std::uint64_t value, unsigned bytes)
+  {
+    for (unsigned i = 0; i < bytes; ++i) {
+      out += char((value >> (8 * i)) & 0xFF);
+    }
+  }
+
+  static std::string common_part(
+      bool begin_event, unsigned kind, double timestamp)
+  {
+    std::uint64_t timestamp_bits;
+    std::memcpy(&timestamp_bits, &timestamp, sizeof(timestamp_bits));
+
+    std::string payload;
+    append_integer(payload, begin_event ? 1 : 0, 1);
+    append_integer(payload, kind, 1);
+    append_integer(payload, timestamp_bits, 8);
+    append_integer(payload, 0, 8);
+    return payload;
+  }
+
+  void append_string(std::string& out, const std::string& s) {
+    for (unsigned i = 0; i < strings.size(); ++i) {
+      if (strings[i] == s) {
+        append_integer(out, i, 4);
+        return;
+      }
+    }
+    append_integer(out, strings.size(), 4);
+    append_integer(out, s.size(), 4);
+    out += s;
+    strings.push_back(s);
+  }
+
+  void append_payload(const std::string& payload) {
+    append_integer(data, payload.size(), 4);
+    data += payload;
+  }
+
+  std::string data;
+  std::vector<std::string> strings;
+};
+
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_empty)
+{
+  metaprogram mp = metaprogram::create_from_binary_string(
+      binary_trace().str(), "some_type", "the_result_type");
+
+  JUST_ASSERT_EQUAL(mp.get_evaluation_result(), "the_result_type");
+  JUST_ASSERT_EQUAL(mp.get_num_vertices(), 1u);
+  JUST_ASSERT_EQUAL(mp.get_num_edges(), 0u);
+  JUST_ASSERT_EQUAL(mp.get_vertex_property(0).name, "some_type");
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_one_node)
+{
+  const std::string trace =
+    binary_trace()
+      .begin(8, "metashell::foo", "foo.hpp", 10, 20, 50.0)
+      .end(8, 100.0)
+      .str();
+
+  metaprogram mp = metaprogram::create_from_binary_string(
+      trace, "some_type", "the_result_type");
+
+  JUST_ASSERT_EQUAL(mp.get_num_vertices(), 2u);
+  JUST_ASSERT_EQUAL(mp.get_num_edges(), 1u);
+  JUST_ASSERT_EQUAL(mp.get_vertex_property(1).name, "metashell::foo");
+
+  metaprogram::optional_edge_descriptor edge = mp.find_edge(0, 1);
+
+  JUST_ASSERT(edge != boost::none);
+  JUST_ASSERT_EQUAL(
+      mp.get_edge_property(*edge).kind, instantiation_kind::memoization);
+  JUST_ASSERT_EQUAL(
+      mp.get_point_of_instantiation(*edge),
+      file_location("foo.hpp", 10, 20));
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_reused_strings)
+{
+  const std::string trace =
+    binary_trace()
+      .begin(0, "metashell::foo", "foo.hpp", 10, 20, 50.0)
+      .begin(0, "metashell::bar", "foo.hpp", 11, 20, 55.0)
+      .end(0, 60.0)
+      .end(0, 70.0)
+      .begin(8, "metashell::bar", "foo.hpp", 12, 20, 80.0)
+      .end(8, 90.0)
+      .str();
+
+  metaprogram mp = metaprogram::create_from_binary_string(
+      trace, "some_type", "the_result_type");
+
+  JUST_ASSERT_EQUAL(mp.get_num_vertices(), 3u);
+  JUST_ASSERT_EQUAL(mp.get_num_edges(), 3u);
+  JUST_ASSERT_EQUAL(mp.get_vertex_property(1).name, "metashell::foo");
+  JUST_ASSERT_EQUAL(mp.get_vertex_property(2).name, "metashell::bar");
+
+  JUST_ASSERT(mp.find_edge(0, 1) != boost::none);
+  JUST_ASSERT(mp.find_edge(1, 2) != boost::none);
+  JUST_ASSERT(mp.find_edge(0, 2) != boost::none);
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_invalid_header)
+{
+  JUST_ASSERT_THROWS(exception,
+    metaprogram::create_from_binary_string(
+        "<?xml", "some_type", "the_result_type"));
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_error_mentions_the_header)
+{
+  std::string error;
+  try {
+    metaprogram::create_from_binary_string(
+        "TL", "some_type", "the_result_type");
+  } catch (const exception& e) {
+    error = e.what();
+  }
+  JUST_ASSERT(error.find("TLBT") != std::string::npos);
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_truncated_entry)
+{
+  std::string trace =
+    binary_trace()
+      .begin(0, "metashell::foo", "foo.hpp", 10, 20, 50.0)
+      .end(0, 100.0)
+      .str();
+  trace.resize(trace.size() - 3);
+
+  JUST_ASSERT_THROWS(exception,
+    metaprogram::create_from_binary_string(
+        trace, "some_type", "the_result_type"));
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_huge_payload_length)
+{
+  // An entry claiming a payload of 4 GB followed by a few bytes only
+  std::string trace = binary_trace().str();
+  trace += std::string(4, '\xff');
+  trace += "abc";
+
+  std::string error;
+  try {
+    metaprogram::create_from_binary_string(
+        trace, "some_type", "the_result_type");
+  } catch (const exception& e) {
+    error = e.what();
+  }
+  JUST_ASSERT_EQUAL(
+    "templight binary parse failed (unexpected end of file)", error);
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_invalid_kind)
+{
+  const std::string trace =
+    binary_trace()
+      .begin(42, "metashell::foo", "foo.hpp", 10, 20, 50.0)
+      .end(42, 100.0)
+      .str();
+
+  JUST_ASSERT_THROWS(exception,
+    metaprogram::create_from_binary_string(
+        trace, "some_type", "the_result_type"));
+}
+
+JUST_TEST_CASE(test_templight_binary_parse_without_template_end)
+{
+  const std::string trace =
+    binary_trace()
+      .begin(0, "metashell::foo", "foo.hpp", 10, 20, 50.0)
+      .str();
+
+  JUST_ASSERT_THROWS(exception,
+    metaprogram::create_from_binary_string(
+        trace, "some_type", "the_result_type"));
+}
@@ -17,7 +17,6 @@
 #include <metashell/exception.hpp>
 #include <metashell/metaprogram.hpp>
 
-#include <boost/graph/lookup_edge.hpp>
 
 #include <just/test.hpp>
 
@@ -54,12 +53,10 @@ void test_single_node_templight_parsing(
   JUST_ASSERT_EQUAL(mp.get_vertex_property(0).name, "some_type");
   JUST_ASSERT_EQUAL(mp.get_vertex_property(1).name, actual_type);
 
-  metaprogram::edge_descriptor edge;
-  bool found;
-  std::tie(edge, found) = boost::lookup_edge(0, 1, mp.get_graph());
+  metaprogram::optional_edge_descriptor edge = mp.find_edge(0, 1);
 
-  JUST_ASSERT(found);
-  JUST_ASSERT_EQUAL(mp.get_edge_property(edge).kind, actual_kind);
+  JUST_ASSERT(edge != boost::none);
+  JUST_ASSERT_EQUAL(mp.get_edge_property(*edge).kind, actual_kind);
 }
 
 JUST_TEST_CASE(test_templight_xml_parse_empty)
@@ -186,21 +183,74 @@ JUST_TEST_CASE(test_templight_xml_parse_two_nested_node)
   JUST_ASSERT_EQUAL(mp.get_vertex_property(1).name, "metashell::foo");
   JUST_ASSERT_EQUAL(mp.get_vertex_property(2).name, "metashell::bar");
 
-  metaprogram::edge_descriptor edge;
-  bool found;
-  std::tie(edge, found) = boost::lookup_edge(0, 1, mp.get_graph());
+  metaprogram::optional_edge_descriptor edge = mp.find_edge(0, 1);
 
-  JUST_ASSERT(found);
-  JUST_ASSERT_EQUAL(mp.get_edge_property(edge).kind,
+  JUST_ASSERT(edge != boost::none);
+  JUST_ASSERT_EQUAL(mp.get_edge_property(*edge).kind,
       instantiation_kind::template_instantiation);
 
-  std::tie(edge, found) = boost::lookup_edge(1, 2, mp.get_graph());
+  edge = mp.find_edge(1, 2);
 
-  JUST_ASSERT(found);
-  JUST_ASSERT_EQUAL(mp.get_edge_property(edge).kind,
+  JUST_ASSERT(edge != boost::none);
+  JUST_ASSERT_EQUAL(mp.get_edge_property(*edge).kind,
       instantiation_kind::template_instantiation);
 }
 
+JUST_TEST_CASE(test_templight_xml_parse_timing_and_memory_usage)
+{
+  const std::string xml =
+  "<?xml version=\"1.0\" standalone=\"yes\"?>\n"
+  "<Trace>\n"
+  "<TemplateBegin>\n"
+  "<Kind>TemplateInstantiation</Kind>\n"
+  "<Context context = \"metashell::foo\"/>\n"
+  "<PointOfInstantiation>foo.hpp|10|20</PointOfInstantiation>\n"
+  "<TimeStamp time = \"50.0\"/>\n"
+  "<MemoryUsage bytes = \"1000\"/>\n"
+  "</TemplateBegin>\n"
+  "<TemplateBegin>\n"
+  "<Kind>TemplateInstantiation</Kind>\n"
+  "<Context context = \"metashell::bar\"/>\n"
+  "<PointOfInstantiation>bar.hpp|20|30</PointOfInstantiation>\n"
+  "<TimeStamp time = \"60.0\"/>\n"
+  "<MemoryUsage bytes = \"1100\"/>\n"
+  "</TemplateBegin>\n"
+  "<TemplateEnd>\n"
+  "<Kind>TemplateInstantiation</Kind>\n"
+  "<TimeStamp time = \"70.0\"/>\n"
+  "<MemoryUsage bytes = \"1400\"/>\n"
+  "</TemplateEnd>\n"
+  "<TemplateEnd>\n"
+  "<Kind>TemplateInstantiation</Kind>\n"
+  "<TimeStamp time = \"100.0\"/>\n"
+  "<MemoryUsage bytes = \"1500\"/>\n"
+  "</TemplateEnd>\n"
+  "</Trace>\n";
+
+  metaprogram mp = metaprogram::create_from_xml_string(
+      xml, "some_type", "the_result_type");
+
+  metaprogram::optional_edge_descriptor edge = mp.find_edge(0, 1);
+
+  JUST_ASSERT(edge != boost::none);
+  const metaprogram::edge_property& foo = mp.get_edge_property(*edge);
+  JUST_ASSERT_EQUAL(foo.begin_timestamp, 50.0);
+  JUST_ASSERT_EQUAL(foo.time_taken, 50.0);
+  JUST_ASSERT_EQUAL(foo.self_time, 40.0);
+  JUST_ASSERT_EQUAL(foo.memory_usage, 500);
+  JUST_ASSERT_EQUAL(foo.self_memory_usage, 200);
+
+  edge = mp.find_edge(1, 2);
+
+  JUST_ASSERT(edge != boost::none);
+  const metaprogram::edge_property& bar = mp.get_edge_property(*edge);
+  JUST_ASSERT_EQUAL(bar.begin_timestamp, 60.0);
+  JUST_ASSERT_EQUAL(bar.time_taken, 10.0);
+  JUST_ASSERT_EQUAL(bar.self_time, 10.0);
+  JUST_ASSERT_EQUAL(bar.memory_usage, 300);
+  JUST_ASSERT_EQUAL(bar.self_memory_usage, 300);
+}
+
 JUST_TEST_CASE(test_templight_xml_parse_two_sequential_node)
 {
   const std::string xml =
@@ -242,18 +292,16 @@ JUST_TEST_CASE(test_templight_xml_parse_two_sequential_node)
   JUST_ASSERT_EQUAL(mp.get_vertex_property(1).name, "metashell::foo");
   JUST_ASSERT_EQUAL(mp.get_vertex_property(2).name, "metashell::bar");
 
-  metaprogram::edge_descriptor edge;
-  bool found;
-  std::tie(edge, found) = boost::lookup_edge(0, 1, mp.get_graph());
+  metaprogram::optional_edge_descriptor edge = mp.find_edge(0, 1);
 
-  JUST_ASSERT(found);
-  JUST_ASSERT_EQUAL(mp.get_edge_property(edge).kind,
+  JUST_ASSERT(edge != boost::none);
+  JUST_ASSERT_EQUAL(mp.get_edge_property(*edge).kind,
       instantiation_kind::template_instantiation);
 
-  std::tie(edge, found) = boost::lookup_edge(0, 2, mp.get_graph());
+  edge = mp.find_edge(0, 2);
 
-  JUST_ASSERT(found);
-  JUST_ASSERT_EQUAL(mp.get_edge_property(edge).kind,
+  JUST_ASSERT(edge != boost::none);
+  JUST_ASSERT_EQUAL(mp.get_edge_property(*edge).kind,
       instantiation_kind::template_instantiation);
 }
 
@@ -378,3 +426,64 @@ JUST_TEST_CASE(test_templight_xml_parse_syntax_error_unknown_kind)
     metaprogram::create_from_xml_string(
         xml, "some_type", "the_result_type"));
 }
+
+JUST_TEST_CASE(test_templight_xml_parse_escaped_context)
+{
+  const std::string xml =
+  "<?xml version=\"1.0\" standalone=\"yes\"?>\n"
+  "<!-- generated by templight -->\n"
+  "<Trace>\n"
+  "<TemplateBegin>\n"
+  "<Kind>TemplateInstantiation</Kind>\n"
+  "<Context context = \"foo&lt;int, &apos;x&apos;&gt;\"/>\n"
+  "<PointOfInstantiation>a&amp;b.hpp|20|30</PointOfInstantiation>\n"
+  "<TimeStamp time = \"60.0\"/>\n"
+  "<MemoryUsage bytes = \"0\"></MemoryUsage>\n"
+  "</TemplateBegin>\n"
+  "<TemplateEnd>\n"
+  "<Kind>TemplateInstantiation</Kind>\n"
+  "<TimeStamp time = \"70.0\"/>\n"
+  "<MemoryUsage bytes = \"0\"/>\n"
+  "</TemplateEnd>\n"
+  "</Trace>\n";
+
+  metaprogram mp = metaprogram::create_from_xml_string(
+      xml, "some_type", "the_result_type");
+
+  JUST_ASSERT_EQUAL(mp.get_num_vertices(), 2u);
+  JUST_ASSERT_EQUAL(mp.get_vertex_property(1).name, "foo<int, 'x'>");
+
+  metaprogram::optional_edge_descriptor edge = mp.find_edge(0, 1);
+
+  JUST_ASSERT(edge != boost::none);
+  JUST_ASSERT_EQUAL(
+      mp.get_point_of_instantiation(*edge),
+      file_location("a&b.hpp", 20, 30));
+}
+
+JUST_TEST_CASE(test_templight_xml_parse_unknown_node)
+{
+  const std::string xml =
+  "<?xml version=\"1.0\" standalone=\"yes\"?>\n"
+  "<Trace>\n"
+  "<TemplateFoo>\n"
+  "</TemplateFoo>\n"
+  "</Trace>\n";
+
+  JUST_ASSERT_THROWS(exception,
+    metaprogram::create_from_xml_string(
+        xml, "some_type", "the_result_type"));
+}
+
+JUST_TEST_CASE(test_templight_xml_parse_unterminated_trace)
+{
+  const std::string xml =
+  "<?xml version=\"1.0\" standalone=\"yes\"?>\n"
+  "<Trace>\n"
+  "<TemplateBegin>\n"
+  "<Kind>TemplateInstantiation</Kind>\n";
+
+  JUST_ASSERT_THROWS(exception,
+    metaprogram::create_from_xml_string(
+        xml, "some_type", "the_result_type"));
+}
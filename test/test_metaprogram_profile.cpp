@@ -0,0 +1,181 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <metashell/metaprogram_profile.hpp>
+
+#include <just/test.hpp>
+
+using namespace metashell;
+
+namespace {
+
+std::string template_begin(
+    const std::string& kind,
+    const std::string& context,
+    const std::string& time,
+    const std::string& bytes)
+{
+  return
+    "<TemplateBegin>\n"
+    "<Kind>" + kind + "</Kind>\n"
+    "<Context context = \"" + context + "\"/>\n"
+    "<PointOfInstantiation>foo.hpp|10|20</PointOfInstantiation>\n"
+    "<TimeStamp time = \"" + time + "\"/>\n"
+    "<MemoryUsage bytes = \"" + bytes + "\"/>\n"
+    "</TemplateBegin>\n";
+}
+
+std::string template_end(
+    const std::string& kind,
+    const std::string& time,
+    const std::string& bytes)
+{
+  return
+    "<TemplateEnd>\n"
+    "<Kind>" + kind + "</Kind>\n"
+    "<TimeStamp time = \"" + time + "\"/>\n"
+    "<MemoryUsage bytes = \"" + bytes + "\"/>\n"
+    "</TemplateEnd>\n";
+}
+
+// foo<int> instantiates bar<int> and bar<char> and bar<int> is memoized
+// once more later.
+metaprogram profiled_metaprogram() {
+  const std::string ti = "TemplateInstantiation";
+  const std::string memo = "Memoization";
+  return metaprogram::create_from_xml_string(
+      "<?xml version=\"1.0\" standalone=\"yes\"?>\n"
+      "<Trace>\n" +
+      template_begin(ti, "foo&lt;int&gt;", "1.0", "0") +
+        template_begin(ti, "bar&lt;int&gt;", "2.0", "100") +
+        template_end(ti, "5.0", "400") +
+        template_begin(ti, "bar&lt;char&gt;", "5.0", "400") +
+        template_end(ti, "6.0", "1400") +
+      template_end(ti, "10.0", "1500") +
+      template_begin(memo, "bar&lt;int&gt;", "10.0", "1500") +
+      template_end(memo, "10.5", "1500") +
+      "</Trace>\n",
+      "some_type",
+      "the_result_type");
+}
+
+}
+
+JUST_TEST_CASE(test_template_name_of_non_template)
+{
+  JUST_ASSERT_EQUAL("int", template_name("int"));
+}
+
+JUST_TEST_CASE(test_template_name_of_nested_templates)
+{
+  JUST_ASSERT_EQUAL(
+      "std::vector::iterator",
+      template_name("std::vector<std::pair<int, char>>::iterator"));
+}
+
+JUST_TEST_CASE(test_profile_instantiations_by_self_time)
+{
+  const std::vector<profile_entry> p =
+    profile_instantiations(profiled_metaprogram(), profile_order::self_time);
+
+  JUST_ASSERT_EQUAL(3u, p.size());
+
+  JUST_ASSERT_EQUAL("foo<int>", p[0].name);
+  JUST_ASSERT_EQUAL(1u, p[0].count);
+  JUST_ASSERT_EQUAL(5.0, p[0].self_time);
+  JUST_ASSERT_EQUAL(9.0, p[0].total_time);
+  JUST_ASSERT_EQUAL(200, p[0].self_memory_usage);
+  JUST_ASSERT_EQUAL(1500, p[0].memory_usage);
+
+  JUST_ASSERT_EQUAL("bar<int>", p[1].name);
+  JUST_ASSERT_EQUAL(1u, p[1].count);
+  JUST_ASSERT_EQUAL(3.0, p[1].self_time);
+
+  JUST_ASSERT_EQUAL("bar<char>", p[2].name);
+}
+
+JUST_TEST_CASE(test_profile_instantiations_by_memory)
+{
+  const std::vector<profile_entry> p =
+    profile_instantiations(profiled_metaprogram(), profile_order::memory);
+
+  JUST_ASSERT_EQUAL(3u, p.size());
+  JUST_ASSERT_EQUAL("bar<char>", p[0].name);
+  JUST_ASSERT_EQUAL("bar<int>", p[1].name);
+  JUST_ASSERT_EQUAL("foo<int>", p[2].name);
+}
+
+JUST_TEST_CASE(test_profile_templates)
+{
+  const std::vector<profile_entry> p =
+    profile_templates(profiled_metaprogram(), profile_order::count);
+
+  JUST_ASSERT_EQUAL(2u, p.size());
+
+  JUST_ASSERT_EQUAL("bar", p[0].name);
+  JUST_ASSERT_EQUAL(2u, p[0].count);
+  JUST_ASSERT_EQUAL(4.0, p[0].self_time);
+  JUST_ASSERT_EQUAL(1300, p[0].self_memory_usage);
+
+  JUST_ASSERT_EQUAL("foo", p[1].name);
+  JUST_ASSERT_EQUAL(1u, p[1].count);
+}
+
+JUST_TEST_CASE(test_profile_skips_disabled_edges)
+{
+  metaprogram mp = profiled_metaprogram();
+  mp.disable_edges_if(
+    [&mp](const metaprogram::edge_descriptor& edge) {
+      return mp.get_vertex_property(mp.get_target(edge)).name == "bar<char>";
+    });
+
+  const std::vector<profile_entry> p =
+    profile_templates(mp, profile_order::count);
+
+  JUST_ASSERT_EQUAL(2u, p.size());
+  JUST_ASSERT_EQUAL("bar", p[0].name);
+  JUST_ASSERT_EQUAL(1u, p[0].count);
+}
+
+JUST_TEST_CASE(test_profile_templates_counts_recursion_in_total_once)
+{
+  const std::string ti = "TemplateInstantiation";
+  // fib<2> instantiates fib<1>, which instantiates fib<0>
+  const metaprogram mp = metaprogram::create_from_xml_string(
+      "<?xml version=\"1.0\" standalone=\"yes\"?>\n"
+      "<Trace>\n" +
+      template_begin(ti, "fib&lt;2&gt;", "1.0", "0") +
+        template_begin(ti, "fib&lt;1&gt;", "2.0", "100") +
+          template_begin(ti, "fib&lt;0&gt;", "3.0", "200") +
+          template_end(ti, "4.0", "300") +
+        template_end(ti, "5.0", "400") +
+      template_end(ti, "7.0", "500") +
+      "</Trace>\n",
+      "some_type",
+      "the_result_type");
+
+  const std::vector<profile_entry> p =
+    profile_templates(mp, profile_order::total_time);
+
+  JUST_ASSERT_EQUAL(1u, p.size());
+  JUST_ASSERT_EQUAL("fib", p[0].name);
+  JUST_ASSERT_EQUAL(3u, p[0].count);
+  JUST_ASSERT_EQUAL(6.0, p[0].self_time);
+  JUST_ASSERT_EQUAL(6.0, p[0].total_time);
+  JUST_ASSERT_EQUAL(500, p[0].self_memory_usage);
+  JUST_ASSERT_EQUAL(500, p[0].memory_usage);
+}
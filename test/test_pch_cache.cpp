@@ -0,0 +1,186 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/pch_cache.hpp>
+
+#include <just/test.hpp>
+#include <just/temp.hpp>
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace metashell;
+
+namespace
+{
+  // Pretends to precompile the header and counts the calls
+  class fake_precompiler
+  {
+  public:
+    explicit fake_precompiler(int& calls_) : _calls(calls_) {}
+
+    void operator()(
+      const std::vector<std::string>& clang_args_,
+      const std::string& header_,
+      const std::string& pch_
+    ) const
+    {
+      ++_calls;
+      std::ofstream(pch_.c_str()) << "pch";
+      std::ofstream(clang_args_.back().c_str()) << "pch: " << header_ << "\n";
+    }
+  private:
+    int& _calls;
+  };
+
+  const std::vector<std::string> no_args;
+}
+
+JUST_TEST_CASE(test_pch_cache_reuses_precompiled_header)
+{
+  just::temp::directory d;
+  int calls = 0;
+
+  pch_cache c1(d.path(), 0);
+  const std::string h1 =
+    c1.precompiled_header("", no_args, "int x;", fake_precompiler(calls));
+
+  pch_cache c2(d.path(), 0);
+  const std::string h2 =
+    c2.precompiled_header("", no_args, "int x;", fake_precompiler(calls));
+
+  JUST_ASSERT_EQUAL(h1, h2);
+  JUST_ASSERT_EQUAL(1, calls);
+}
+
+JUST_TEST_CASE(test_pch_cache_precompiles_different_content)
+{
+  just::temp::directory d;
+  int calls = 0;
+
+  pch_cache c(d.path(), 0);
+  const std::string h1 =
+    c.precompiled_header("", no_args, "int x;", fake_precompiler(calls));
+  const std::string h2 =
+    c.precompiled_header("", no_args, "int y;", fake_precompiler(calls));
+
+  JUST_ASSERT_NOT_EQUAL(h1, h2);
+  JUST_ASSERT_EQUAL(2, calls);
+}
+
+JUST_TEST_CASE(test_pch_cache_precompiles_with_different_arguments)
+{
+  just::temp::directory d;
+  int calls = 0;
+
+  pch_cache c(d.path(), 0);
+  c.precompiled_header("", no_args, "int x;", fake_precompiler(calls));
+  c.precompiled_header(
+    "",
+    std::vector<std::string>(1, "-DFOO"),
+    "int x;",
+    fake_precompiler(calls)
+  );
+
+  JUST_ASSERT_EQUAL(2, calls);
+}
+
+JUST_TEST_CASE(test_pch_cache_header_contains_the_content)
+{
+  just::temp::directory d;
+  int calls = 0;
+
+  pch_cache c(d.path(), 0);
+  const std::string h =
+    c.precompiled_header("", no_args, "int x;", fake_precompiler(calls));
+
+  std::ifstream f(h.c_str());
+  std::string content;
+  std::getline(f, content);
+  JUST_ASSERT_EQUAL("int x;", content);
+}
+
+
+namespace
+{
+  // Pretends to precompile the header into a 768 KB precompiled header
+  void big_precompiler(
+    const std::vector<std::string>& clang_args_,
+    const std::string& header_,
+    const std::string& pch_
+  )
+  {
+    std::ofstream(pch_.c_str()) << std::string(768 * 1024, 'x');
+    std::ofstream(clang_args_.back().c_str()) << "pch: " << header_ << "\n";
+  }
+
+  bool exists(const std::string& path_)
+  {
+    return std::ifstream(path_.c_str()).good();
+  }
+}
+
+JUST_TEST_CASE(test_pch_cache_does_not_remove_pinned_precompiled_header)
+{
+  just::temp::directory d;
+
+  pch_cache c(d.path(), 1);
+  const std::string h1 =
+    c.precompiled_header("", no_args, "int x;", big_precompiler);
+  const std::string h2 =
+    c.precompiled_header("", no_args, "int y;", big_precompiler);
+
+  JUST_ASSERT(exists(h1 + ".pch"));
+  JUST_ASSERT(exists(h2 + ".pch"));
+}
+
+JUST_TEST_CASE(test_pch_cache_removes_precompiled_header_after_unpinning)
+{
+  just::temp::directory d;
+
+  std::string h1;
+  {
+    pch_cache c(d.path(), 1);
+    h1 = c.precompiled_header("", no_args, "int x;", big_precompiler);
+  }
+
+  pch_cache c(d.path(), 1);
+  const std::string h2 =
+    c.precompiled_header("", no_args, "int y;", big_precompiler);
+
+  JUST_ASSERT(!exists(h1 + ".pch"));
+  JUST_ASSERT(exists(h2 + ".pch"));
+}
+
+JUST_TEST_CASE(test_copy_of_pch_cache_pins_the_same_precompiled_headers)
+{
+  just::temp::directory d;
+
+  std::string h1;
+  std::unique_ptr<pch_cache> copy;
+  {
+    pch_cache c(d.path(), 1);
+    h1 = c.precompiled_header("", no_args, "int x;", big_precompiler);
+    copy.reset(new pch_cache(c));
+  }
+
+  pch_cache c(d.path(), 1);
+  c.precompiled_header("", no_args, "int y;", big_precompiler);
+
+  JUST_ASSERT(exists(h1 + ".pch"));
+}
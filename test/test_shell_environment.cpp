@@ -53,6 +53,29 @@ JUST_TEST_CASE(test_env_pop_reverts_changes_since_push)
   JUST_ASSERT_EQUAL(old_env, sh.env().get_all());
 }
 
+JUST_TEST_CASE(test_env_pop_restores_the_environment_object)
+{
+  test_shell sh;
+
+  const metashell::environment* old_env_ptr = &sh.env();
+  sh.push_environment();
+  sh.store_in_buffer("typedef int x;");
+  sh.pop_environment();
+
+  JUST_ASSERT_EQUAL(old_env_ptr, &sh.env());
+}
+
+JUST_TEST_CASE(test_pushed_environment_keeps_the_content)
+{
+  test_shell sh;
+
+  sh.store_in_buffer("typedef int x;");
+  const std::string old_env = sh.env().get_all();
+  sh.push_environment();
+
+  JUST_ASSERT_EQUAL(old_env, sh.env().get_all());
+}
+
 JUST_TEST_CASE(test_more_pops_than_pushes_throws)
 {
   test_shell sh;
@@ -201,3 +224,44 @@ JUST_TEST_CASE(test_restoring_after_environment_reset_from_environment_stack)
   JUST_ASSERT(sh.error().empty());
 }
 
+
+JUST_TEST_CASE(test_function_bodies_are_checked_by_default)
+{
+  test_shell sh;
+  sh.line_available("void f() { nonexisting_function(); }");
+
+  JUST_ASSERT(!sh.error().empty());
+}
+
+JUST_TEST_CASE(test_function_bodies_are_skipped_when_validating_declarations)
+{
+  metashell::config cfg;
+  cfg.validate_declarations_only = true;
+  test_shell sh(cfg, 80);
+  sh.line_available("void f() { nonexisting_function(); }");
+
+  JUST_ASSERT_EQUAL("", sh.error());
+
+  sh.line_available("#msh environment check");
+
+  JUST_ASSERT(!sh.error().empty());
+}
+
+JUST_TEST_CASE(test_declarations_are_checked_when_validating_declarations)
+{
+  metashell::config cfg;
+  cfg.validate_declarations_only = true;
+  test_shell sh(cfg, 80);
+  sh.line_available("typedef nonexisting_type x;");
+
+  JUST_ASSERT(!sh.error().empty());
+}
+
+JUST_TEST_CASE(test_checking_a_valid_environment)
+{
+  test_shell sh;
+  sh.line_available("#msh environment check");
+
+  JUST_ASSERT_EQUAL("", sh.error());
+  JUST_ASSERT_EQUAL("// The environment is valid\n", sh.output());
+}
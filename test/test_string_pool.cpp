@@ -0,0 +1,63 @@
+
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Andras Kucsma (andras.kucsma@gmail.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/string_pool.hpp>
+
+#include <just/test.hpp>
+
+#include <sstream>
+
+using namespace metashell;
+
+JUST_TEST_CASE(test_string_pool_interns_strings_once)
+{
+  string_pool pool;
+
+  const string_pool::id_type foo = pool.intern("foo.hpp");
+  const string_pool::id_type bar = pool.intern("bar.hpp");
+
+  JUST_ASSERT(foo != bar);
+  JUST_ASSERT_EQUAL(foo, pool.intern(std::string("foo.hpp")));
+  JUST_ASSERT_EQUAL(2u, pool.size());
+  JUST_ASSERT_EQUAL("foo.hpp", pool[foo]);
+  JUST_ASSERT_EQUAL("bar.hpp", pool[bar]);
+}
+
+JUST_TEST_CASE(test_string_pool_find)
+{
+  string_pool pool;
+  const string_pool::id_type id = pool.intern("foo.hpp");
+
+  JUST_ASSERT(pool.find("foo.hpp") == id);
+  JUST_ASSERT(!pool.find("foo"));
+  JUST_ASSERT(!pool.find(""));
+}
+
+JUST_TEST_CASE(test_string_pool_many_strings)
+{
+  string_pool pool;
+  for (int i = 0; i != 1000; ++i) {
+    std::ostringstream s;
+    s << "file" << i << ".hpp";
+    JUST_ASSERT_EQUAL(string_pool::id_type(i), pool.intern(s.str()));
+  }
+
+  JUST_ASSERT_EQUAL(1000u, pool.size());
+  JUST_ASSERT(pool.find("file0.hpp") == string_pool::id_type(0));
+  JUST_ASSERT(pool.find("file999.hpp") == string_pool::id_type(999));
+  JUST_ASSERT_EQUAL("file500.hpp", pool[500]);
+}
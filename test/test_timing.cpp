@@ -0,0 +1,110 @@
+// Metashell - Interactive C++ template metaprogramming shell
+// Copyright (C) 2014, Abel Sinkovics (abel@sinkovics.hu)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <metashell/timing.hpp>
+
+#include "test_shell.hpp"
+
+#include <just/test.hpp>
+
+#include <string>
+
+using namespace metashell;
+
+JUST_TEST_CASE(test_timing_is_empty_by_default)
+{
+  const timing t;
+
+  JUST_ASSERT(t.get_stages().empty());
+  JUST_ASSERT(t.get_resources().empty());
+  JUST_ASSERT_EQUAL(0, t.queries());
+}
+
+JUST_TEST_CASE(test_timing_sums_the_time_spent_in_a_stage)
+{
+  timing t;
+  t.add_stage("parse", 1);
+  t.add_stage("display", 3);
+  t.add_stage("parse", 2);
+
+  JUST_ASSERT_EQUAL(2u, t.get_stages().size());
+  JUST_ASSERT_EQUAL("parse", t.get_stages()[0].first);
+  JUST_ASSERT_EQUAL(3.0, t.get_stages()[0].second);
+}
+
+JUST_TEST_CASE(test_timing_keeps_the_largest_resource_usage)
+{
+  timing t1;
+  t1.add_resource_usage("AST", 10);
+  t1.count_query();
+
+  timing t2;
+  t2.add_resource_usage("AST", 5);
+  t2.count_query();
+
+  t1.add(t2);
+
+  JUST_ASSERT_EQUAL(1u, t1.get_resources().size());
+  JUST_ASSERT_EQUAL(10u, t1.get_resources()[0].second);
+  JUST_ASSERT_EQUAL(2, t1.queries());
+}
+
+JUST_TEST_CASE(test_timed_stage_is_recorded_in_the_installed_timing)
+{
+  timing t;
+  {
+    timing_recorder r(t);
+    timed_stage s("test");
+  }
+  {
+    timed_stage s("not recorded");
+  }
+
+  JUST_ASSERT_EQUAL(1u, t.get_stages().size());
+  JUST_ASSERT_EQUAL("test", t.get_stages()[0].first);
+}
+
+JUST_TEST_CASE(test_timing_is_not_displayed_by_default)
+{
+  test_shell sh;
+  sh.line_available("int");
+
+  JUST_ASSERT_EQUAL("int", sh.output());
+}
+
+JUST_TEST_CASE(test_timing_is_displayed_after_the_result)
+{
+  test_shell sh;
+  sh.line_available("#msh timing on");
+  sh.line_available("int");
+
+  JUST_ASSERT_NOT_EQUAL(std::string::npos, sh.output().find("int// "));
+  JUST_ASSERT_NOT_EQUAL(std::string::npos, sh.output().find("// parse: "));
+}
+
+JUST_TEST_CASE(test_timing_totals)
+{
+  test_shell sh;
+  sh.line_available("int");
+  sh.line_available("double");
+  sh.line_available("#msh timing totals");
+
+  JUST_ASSERT_NOT_EQUAL(
+    std::string::npos,
+    sh.output().find("// Timing of 2 queries\n")
+  );
+}
+